@@ -0,0 +1,549 @@
+#include <chrono>
+#include <deque>
+#include <list>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <cstdint>
+#include <numeric>
+#include "../undo_redo_grid_index.h"
+#include "../undo_redo_hash_index.h"
+#include "../undo_redo_gap_buffer.h"
+#include "../undo_redo_chunked_vector.h"
+#include "../undo_redo_change_stream.h"
+#include "../undo_redo_content_hash.h"
+
+using namespace shos;
+
+template <typename TFunction>
+double measure(TFunction function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct shape
+{
+    int            id;
+    grid_rectangle bounds;
+
+    bool operator==(const shape& other) const
+    {
+        return id == other.id;
+    }
+};
+
+void grid_index_benchmark()
+{
+    const int    shape_count = 100000;
+    const int    query_count = 10000;
+    const double world_size  = 10000.0;
+
+    std::mt19937                           random(1);
+    std::uniform_real_distribution<double> position(0.0, world_size);
+    std::uniform_real_distribution<double> extent(1.0, 50.0);
+
+    undo_redo_vector<shape>     shapes;
+    undo_redo_grid_index<shape> index(shapes, 100.0, [](const shape& shape) { return shape.bounds; });
+
+    auto build = measure([&] {
+        undo_redo_vector<shape>::transaction transaction(shapes);
+        for (int id = 0; id < shape_count; id++) {
+            auto x = position(random);
+            auto y = position(random);
+            shapes.push_back({ id, { x, y, x + extent(random), y + extent(random) } });
+        }
+    });
+    auto undo = measure([&] { shapes.undo(); });
+    auto redo = measure([&] { shapes.redo(); });
+
+    std::vector<grid_rectangle> areas;
+    for (int count = 0; count < query_count; count++) {
+        auto x = position(random);
+        auto y = position(random);
+        areas.push_back({ x, y, x + 200.0, y + 200.0 });
+    }
+
+    std::size_t found_by_scan  = 0;
+    std::size_t found_by_index = 0;
+    auto scan = measure([&] {
+        for (const auto& area : areas)
+            found_by_scan += std::count_if(shapes.cbegin(), shapes.cend(), [&](const shape& shape) { return shape.bounds.intersects(area); });
+    });
+    auto query = measure([&] {
+        for (const auto& area : areas)
+            found_by_index += index.query(area).size();
+    });
+
+    std::printf("grid index: %d shapes\n", shape_count);
+    std::printf("  push_back with index : %10.3f ms\n", build);
+    std::printf("  undo / redo of group : %10.3f ms / %.3f ms\n", undo, redo);
+    std::printf("  %d rectangle queries : scan %10.3f ms, index %10.3f ms (%zu / %zu hits)\n", query_count, scan, query, found_by_scan, found_by_index);
+}
+
+void hash_index_benchmark()
+{
+    const int element_count = 100000;
+    const int lookup_count  = 10000;
+
+    undo_redo_vector<int> array;
+    for (int value = 0; value < element_count; value++)
+        array.push_back(value);
+
+    std::mt19937                       random(1);
+    std::uniform_int_distribution<int> value(0, element_count - 1);
+    std::vector<int>                   values;
+    for (int count = 0; count < lookup_count; count++)
+        values.push_back(value(random));
+
+    std::size_t found_by_scan  = 0;
+    std::size_t found_by_index = 0;
+    auto scan = measure([&] {
+        for (auto value : values)
+            found_by_scan += std::find(array.begin(), array.end(), value) != array.end() ? 1 : 0;
+    });
+
+    undo_redo_hash_index<int> index(array);
+    auto lookup = measure([&] {
+        for (auto value : values)
+            found_by_index += index.contains(value) ? 1 : 0;
+    });
+
+    auto erase = measure([&] {
+        for (int count = 0; count < 1000; count++)
+            index.erase_value(element_count - 1 - count);
+    });
+
+    // Erasures in the middle shift every later element.
+    auto erase_middle_by_scan = measure([&] {
+        for (int count = 0; count < 1000; count++) {
+            auto iterator = std::find(array.begin(), array.end(), element_count / 4 + count);
+            if (iterator != array.end())
+                array.erase(iterator);
+        }
+    });
+    auto erase_middle = measure([&] {
+        for (int count = 0; count < 1000; count++)
+            index.erase_value(element_count / 2 + count);
+    });
+    auto insert_middle = measure([&] {
+        for (int count = 0; count < 1000; count++)
+            array.insert(std::next(array.begin(), array.size() / 2), element_count + count);
+    });
+
+    std::printf("hash index: %d elements\n", element_count);
+    std::printf("  %d lookups           : scan %10.3f ms, index %10.3f ms (%zu / %zu hits)\n", lookup_count, scan, lookup, found_by_scan, found_by_index);
+    std::printf("  1000 erase_value at tail : %10.3f ms\n", erase);
+    std::printf("  1000 erase in the middle : scan %10.3f ms, index %10.3f ms\n", erase_middle_by_scan, erase_middle);
+    std::printf("  1000 insert in the middle: %10.3f ms\n", insert_middle);
+}
+
+// Inserts and erases around a cursor in the middle of the collection, then undoes and redoes every edit.
+template <typename TCollection>
+void middle_edit_benchmark(const char* name)
+{
+    const int element_count = 100000;
+    const int edit_count    = 20000;
+
+    undo_redo_collection<int, TCollection> collection;
+    for (int value = 0; value < element_count; value++)
+        collection.push_back(value);
+
+    auto cursor = std::next(collection.begin(), element_count / 2);
+    auto edit = measure([&] {
+        for (int count = 0; count < edit_count; count++) {
+            if constexpr (std::is_same_v<TCollection, std::list<int>>) {
+                collection.insert(cursor, count);
+                if (count % 4 == 3)
+                    collection.erase(std::prev(cursor));
+            } else {
+                collection.insert(std::next(collection.begin(), collection.size() / 2), count);
+                if (count % 4 == 3)
+                    collection.erase(std::next(collection.begin(), collection.size() / 2));
+            }
+        }
+    });
+    auto undo = measure([&] { while (collection.size() > static_cast<std::size_t>(element_count) && collection.undo()) ; });
+    auto redo = measure([&] { while (collection.redo()) ; });
+
+    std::printf("  %-12s: edit %10.3f ms, undo %10.3f ms, redo %10.3f ms\n", name, edit, undo, redo);
+}
+
+// Types at a cursor near the front of a large document, with a backspace after every fourth keystroke,
+// then undoes and redoes the whole session.
+template <typename TCollection>
+void typing_benchmark(const char* name)
+{
+    const int document_size   = 200000;
+    const int keystroke_count = 20000;
+
+    undo_redo_collection<char, TCollection> document;
+    for (int count = 0; count < document_size; count++)
+        document.push_back(static_cast<char>('a' + count % 26));
+
+    std::size_t cursor = 1000;
+    auto typing = measure([&] {
+        for (int count = 0; count < keystroke_count; count++) {
+            document.insert(std::next(document.begin(), cursor++), 'x');
+            if (count % 4 == 3)
+                document.erase(std::next(document.begin(), --cursor));
+        }
+    });
+    auto undo = measure([&] { while (document.size() > static_cast<std::size_t>(document_size) && document.undo()) ; });
+    auto redo = measure([&] { while (document.redo()) ; });
+
+    std::printf("  %-16s: typing %10.3f ms, undo %10.3f ms, redo %10.3f ms\n", name, typing, undo, redo);
+}
+
+// Undoes and redoes one transaction of update steps on disjoint indices, serially and in parallel.
+// For scaling numbers, run it under an affinity mask that limits the cores, e.g. "start /affinity 0xF" or "taskset -c 0-3".
+void parallel_group_benchmark()
+{
+    const int element_count = 500000;
+
+    std::printf("parallel group undo: %d updates, %u hardware threads\n", element_count, std::thread::hardware_concurrency());
+    for (auto threshold : { SIZE_MAX, undo_redo_vector<double>::default_parallel_threshold }) {
+        undo_redo_vector<double> array;
+        array.set_parallel_threshold(threshold);
+        for (int index = 0; index < element_count; index++)
+            array.push_back(index);
+        {
+            undo_redo_vector<double>::transaction transaction(array);
+            for (int index = 0; index < element_count; index++)
+                array.update(std::next(array.begin(), index), -index);
+        }
+
+        auto first_undo = measure([&] { array.undo(); });
+        auto redo       = measure([&] { array.redo(); });
+        auto undo       = measure([&] { array.undo(); });
+        std::printf("  %-8s: first undo %10.3f ms, redo %10.3f ms, undo %10.3f ms\n", threshold == SIZE_MAX ? "serial" : "parallel", first_undo, redo, undo);
+    }
+}
+
+// Translates every element once by a loop of update() calls in a transaction and once by transform().
+void transform_benchmark()
+{
+    const int element_count = 500000;
+
+    std::printf("bulk update: %d elements\n", element_count);
+    for (auto bulk : { false, true }) {
+        undo_redo_vector<double> array;
+        for (int index = 0; index < element_count; index++)
+            array.push_back(index);
+
+        auto update = measure([&] {
+            if (bulk) {
+                array.transform(array.begin(), array.end(), [](double value) { return value + 1.0; });
+            } else {
+                undo_redo_vector<double>::transaction transaction(array);
+                for (auto iterator = array.begin(); iterator != array.end(); ++iterator)
+                    array.update(iterator, *iterator + 1.0);
+            }
+        });
+        auto undo = measure([&] { array.undo(); });
+        auto redo = measure([&] { array.redo(); });
+        std::printf("  %-10s: update %10.3f ms, undo %10.3f ms, redo %10.3f ms\n", bulk ? "transform" : "update", update, undo, redo);
+    }
+}
+
+// Loads elements by push_back one step at a time and as one append run, then undoes the load.
+void bulk_load_benchmark()
+{
+    const int element_count = 1000000;
+
+    std::vector<int> source(element_count);
+    std::iota(source.begin(), source.end(), 0);
+
+    std::printf("bulk load: %d push_backs\n", element_count);
+    for (auto run : { false, true }) {
+        undo_redo_vector<int> array;
+        auto load = measure([&] {
+            if (run)
+                array.append_range(source);
+            else
+                std::for_each(source.begin(), source.end(), [&](int value) { array.push_back(value); });
+        });
+        auto undo = measure([&] { while (array.undo()) ; });
+        auto redo = measure([&] { while (array.redo()) ; });
+        std::printf("  %-12s: load %10.3f ms, undo %10.3f ms, redo %10.3f ms\n", run ? "append_range" : "push_back", load, undo, redo);
+    }
+}
+
+// Loads a million elements by push_back, with and without reserving room for the elements and the history first.
+void reserve_benchmark()
+{
+    const int element_count = 1000000;
+
+    std::printf("reserve: %d push_backs\n", element_count);
+    for (auto reserve : { false, true }) {
+        undo_redo_vector<int> array;
+        auto load = measure([&] {
+            if (reserve) {
+                array.reserve(element_count);
+                array.reserve_history(element_count);
+            }
+            for (int value = 0; value < element_count; value++)
+                array.push_back(value);
+        });
+        auto stats = array.stats();
+        std::printf("  %-9s: load %10.3f ms, %zu / %zu elements, %zu / %zu steps\n", reserve ? "reserved" : "growing", load,
+                    stats.element_count, stats.element_capacity, stats.step_count, stats.step_capacity);
+    }
+}
+
+// Forks a loaded document, then edits one element of the source and one of the fork, and undoes the latter.
+template <typename TCollection>
+void fork_benchmark(const char* name)
+{
+    const int element_count = 1000000;
+
+    undo_redo_collection<int, TCollection> array;
+    for (int value = 0; value < element_count; value++)
+        array.push_back(value);
+
+    std::size_t sum  = 0;
+    auto        fork = measure([&] {
+        auto copy = array.fork();
+        sum += copy.size();
+    });
+
+    auto copy        = array.fork();
+    auto source_edit = measure([&] { array.update(std::next(array.begin(), element_count / 2), -1); });
+    auto edit        = measure([&] { copy.update(copy.begin(), -1); });
+    auto undo        = measure([&] { copy.undo(); });
+
+    std::printf("  %-14s: fork %10.3f ms, source edit %10.3f ms, first edit %10.3f ms, first undo %10.3f ms\n", name, fork, source_edit, edit, undo);
+}
+
+// Records one transaction of updates at random positions and of erases and inserts near the tail, then replays it serially.
+void group_replay_benchmark()
+{
+    const int element_count = 1000000;
+    const int step_count    = 1000000;
+
+    undo_redo_vector<int> array;
+    array.set_parallel_threshold(SIZE_MAX);
+    for (int value = 0; value < element_count; value++)
+        array.push_back(value);
+
+    std::mt19937                               random(1);
+    std::uniform_int_distribution<std::size_t> position(0, element_count - 1);
+    auto record = measure([&] {
+        undo_redo_vector<int>::transaction transaction(array);
+        for (int count = 0; count < step_count; count++) {
+            if (count % 8 == 7) {
+                array.erase(std::prev(array.end(), 2));
+                array.insert(std::prev(array.end()), count);
+            } else {
+                array.update(std::next(array.begin(), position(random)), count);
+            }
+        }
+    });
+    auto undo = measure([&] { array.undo(); });
+    auto redo = measure([&] { array.redo(); });
+
+    std::printf("group replay: %d steps in one transaction\n", step_count);
+    std::printf("  record %10.3f ms, undo %10.3f ms (%.1f steps/us), redo %10.3f ms (%.1f steps/us)\n",
+                record, undo, step_count / undo / 1000.0, redo, step_count / redo / 1000.0);
+}
+
+// Keeps the content hash of a large collection through inserts in the middle and their undo, against hashing it all after each change.
+void content_hash_benchmark()
+{
+    const int element_count = 1000000;
+    const int edit_count    = 1000;
+
+    undo_redo_vector<int> array;
+    std::vector<int>      values(element_count);
+    std::iota(values.begin(), values.end(), 0);
+    array.append_range(values);
+
+    std::uint64_t rehashed = 0;
+    auto rehash = measure([&] {
+        for (int count = 0; count < edit_count; count++) {
+            array.insert(std::next(array.begin(), element_count / 2), count);
+            rehashed = std::accumulate(array.cbegin(), array.cend(), std::uint64_t(0), [](std::uint64_t hash, int value) { return hash * 31 + std::hash<int>()(value); });
+        }
+    });
+    while (array.size() > static_cast<std::size_t>(element_count))
+        array.undo();
+
+    undo_redo_content_hash<int> hash(array);
+    auto before      = hash.value();
+    auto incremental = measure([&] {
+        for (int count = 0; count < edit_count; count++)
+            array.insert(std::next(array.begin(), element_count / 2), count);
+        for (int count = 0; count < edit_count; count++)
+            array.undo();
+    });
+
+    std::printf("content hash: %d inserts in the middle of %d elements\n", edit_count, element_count);
+    std::printf("  rehash after each %10.3f ms, incremental with undo %10.3f ms (%s after undo)\n",
+                rehash, incremental, hash.value() == before && rehashed != 0 ? "same" : "different");
+}
+
+// Undoes a transaction of a million updates in slices of at most 2 ms, as a UI would between two frames.
+void sliced_undo_benchmark()
+{
+    const int element_count = 1000000;
+
+    undo_redo_vector<int> array;
+    array.set_parallel_threshold(SIZE_MAX);
+    for (int value = 0; value < element_count; value++)
+        array.push_back(value);
+
+    std::mt19937                               random(1);
+    std::uniform_int_distribution<std::size_t> position(0, element_count - 1);
+    {
+        undo_redo_vector<int>::transaction transaction(array);
+        for (int count = 0; count < element_count; count++)
+            array.update(std::next(array.begin(), position(random)), count);
+    }
+
+    auto   whole       = measure([&] { array.undo(); });
+    array.redo();
+    int    frame_count = 0;
+    double longest     = 0.0;
+    for (auto done = false; !done; frame_count++)
+        longest = std::max(longest, measure([&] { done = array.undo_for(std::chrono::milliseconds(2)); }));
+
+    std::printf("sliced undo: %d updates in one transaction\n", element_count);
+    std::printf("  undo %10.3f ms, undo_for(2 ms) %d frames, longest frame %10.3f ms\n", whole, frame_count, longest);
+}
+
+// Streams transactions of updates at random positions to a replica through an in-memory pipe, then undoes and redoes them all.
+void change_stream_benchmark()
+{
+    const int element_count     = 100000;
+    const int transaction_count = 10000;
+    const int transaction_size  = 100;
+    const int change_count      = transaction_count * transaction_size;
+
+    std::vector<std::byte>  pipe;
+    undo_redo_vector<int>   source;
+    undo_redo_change_stream stream(source, [&](const std::byte* bytes, std::size_t size) { pipe.insert(pipe.end(), bytes, bytes + size); });
+    undo_redo_vector<int>   target;
+    undo_redo_replica       replica(target);
+
+    std::vector<int> values(element_count);
+    std::iota(values.begin(), values.end(), 0);
+    source.append_range(values);
+
+    std::mt19937                               random(1);
+    std::uniform_int_distribution<std::size_t> position(0, element_count - 1);
+    auto record = measure([&] {
+        for (int transaction_index = 0; transaction_index < transaction_count; transaction_index++) {
+            undo_redo_vector<int>::transaction transaction(source);
+            for (int count = 0; count < transaction_size; count++)
+                source.update(std::next(source.begin(), position(random)), count);
+        }
+        while (source.undo())
+            ;
+        while (source.redo())
+            ;
+    });
+
+    auto bytes = pipe.size();
+    auto apply = measure([&] {
+        const std::size_t chunk_size = 65536;
+        for (std::size_t first = 0; first < pipe.size(); first += chunk_size)
+            replica.read(pipe.data() + first, std::min(chunk_size, pipe.size() - first));
+    });
+
+    std::printf("change stream: %d transactions of %d updates into %d elements, then undo and redo of all\n", transaction_count, transaction_size, element_count);
+    std::printf("  %zu bytes (%.1f per update), a whole vector per change would be %zu bytes\n",
+                bytes, static_cast<double>(bytes) / change_count, sizeof(int) * element_count * (transaction_count * 3 + 1));
+    std::printf("  record and write %10.3f ms (%.1f MB/s), apply %10.3f ms (%.1f MB/s, %.1f updates/us), replica %s\n",
+                record, bytes / record / 1000.0, apply, bytes / apply / 1000.0, change_count / apply / 1000.0,
+                std::equal(source.begin(), source.end(), target.begin()) ? "identical" : "different");
+}
+
+// Deletes a scattered selection, as erases in a transaction and as one erase_indices(), and undoes it.
+void scattered_erase_benchmark()
+{
+    const int element_count   = 200000;
+    const int selection_count = 5000;
+
+    std::vector<int> source(element_count);
+    std::iota(source.begin(), source.end(), 0);
+    std::vector<std::size_t> selection(selection_count);
+    for (int index = 0; index < selection_count; index++)
+        selection[index] = static_cast<std::size_t>(index) * element_count / selection_count;
+
+    std::printf("scattered erase: %d of %d elements\n", selection_count, element_count);
+    for (auto compaction : { false, true }) {
+        undo_redo_vector<int> array;
+        array.append_range(source);
+        auto erase = measure([&] {
+            if (compaction) {
+                array.erase_indices(selection);
+            } else {
+                undo_redo_vector<int>::transaction transaction(array);
+                std::for_each(selection.rbegin(), selection.rend(), [&](std::size_t index) { array.erase_at(index); });
+            }
+        });
+        auto undo = measure([&] { array.undo(); });
+        auto redo = measure([&] { array.redo(); });
+        std::printf("  %-13s: erase %10.3f ms, undo %10.3f ms, redo %10.3f ms\n", compaction ? "erase_indices" : "transaction", erase, undo, redo);
+    }
+}
+
+// Discards an undone transaction that replaced a million pointers into an arena, then resets the collection.
+// The per-element clean-up is called once for each pointer; the span clean-up releases them in bulk.
+void clean_up_benchmark()
+{
+    const int element_count = 1000000;
+
+    std::vector<int>  arena(element_count * 2 + 1);
+    std::vector<int*> pointers(element_count);
+    std::size_t       released = 0;
+
+    std::printf("clean-up: %d pointers into an arena\n", element_count);
+    for (auto span : { false, true }) {
+        auto array = span ? undo_redo_vector<int*>([&](std::span<int* const> pointers) { released += pointers.size(); })
+                          : undo_redo_vector<int*>([&](int*) { released++; });
+        std::transform(arena.begin(), arena.begin() + element_count, pointers.begin(), [](int& value) { return &value; });
+        array.append_range(pointers);
+        {
+            undo_redo_vector<int*>::transaction transaction(array);
+            for (int index = 0; index < element_count; index++)
+                array.update_at(index, &arena[element_count + index]);
+        }
+        array.undo();
+
+        auto discard = measure([&] { array.push_back(&arena[element_count * 2]); });
+        auto reset   = measure([&] { array.reset(); });
+        std::printf("  %-11s: discard redo steps %10.3f ms, reset %10.3f ms\n", span ? "span" : "per-element", discard, reset);
+    }
+    std::printf("  %zu released\n", released);
+}
+
+int main()
+{
+    grid_index_benchmark();
+    hash_index_benchmark();
+
+    std::printf("middle edits: 20000 inserts / 5000 erases into 100000 elements\n");
+    middle_edit_benchmark<std::vector<int>>("std::vector");
+    middle_edit_benchmark<std::deque <int>>("std::deque");
+    middle_edit_benchmark<std::list  <int>>("std::list");
+
+    std::printf("typing: 20000 keystrokes and 5000 backspaces at offset 1000 of 200000 characters\n");
+    typing_benchmark<std::vector<char>>("std::vector");
+    typing_benchmark<gap_buffer <char>>("gap_buffer");
+
+    parallel_group_benchmark();
+    transform_benchmark();
+    bulk_load_benchmark();
+    reserve_benchmark();
+    std::printf("fork: 1000000 elements and steps\n");
+    fork_benchmark<std::vector   <int>>("std::vector");
+    fork_benchmark<chunked_vector<int>>("chunked_vector");
+    group_replay_benchmark();
+    sliced_undo_benchmark();
+    content_hash_benchmark();
+    change_stream_benchmark();
+    scattered_erase_benchmark();
+    clean_up_benchmark();
+}
@@ -0,0 +1,110 @@
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include "../undo_redo_fixed_vector.h"
+
+// Not "MemoryLeakTest.h": its new macro would rename the replacements below.
+// The global operator new is replaced in this program only, so that it counts the allocations.
+// The std::align_val_t forms are left alone; nothing here allocates over-aligned memory.
+
+static std::size_t allocation_count = 0;
+
+static void* allocate(std::size_t size) noexcept
+{
+    allocation_count++;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(std::size_t size)
+{
+    if (auto pointer = allocate(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    if (auto pointer = allocate(size))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+using namespace shos;
+
+// Runs long random edit / transaction / undo / redo sequences on an undo_redo_fixed_vector. Returns false if anything allocated.
+bool undo_redo_fixed_vector_allocation_test()
+{
+    std::mt19937 random(1);
+    auto         count = allocation_count;
+
+    undo_redo_fixed_vector<int, 64, 32> array;
+    for (int operation = 0; operation < 100000; operation++) {
+        auto kind = random() % 10;
+        if (kind < 3 && array.size() < array.capacity()) {
+            array.insert_at(random() % (array.size() + 1), operation);
+        } else if (kind < 5 && array.size() > 0) {
+            array.erase_at(random() % array.size());
+        } else if (kind < 6 && array.size() > 0) {
+            array.update_at(random() % array.size(), operation);
+        } else if (kind < 7) {
+            undo_redo_fixed_vector<int, 64, 32>::transaction transaction(array);
+            for (int index = 0; index < 4 && array.size() < array.capacity(); index++)
+                array.push_back(operation);
+        } else if (kind < 9) {
+            array.undo();
+        } else {
+            array.redo();
+        }
+    }
+    while (array.undo())
+        ;
+    while (array.redo())
+        ;
+    array.reset();
+
+    if (allocation_count == count)
+        return true;
+    std::printf("undo_redo_fixed_vector allocated %zu times\n", allocation_count - count);
+    return false;
+}
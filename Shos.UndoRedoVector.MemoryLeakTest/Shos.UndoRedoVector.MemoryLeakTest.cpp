@@ -3,6 +3,9 @@
 
 using namespace shos;
 
+// In Shos.UndoRedoVector.AllocationTest.cpp.
+bool undo_redo_fixed_vector_allocation_test();
+
 class foo
 {
     int value;
@@ -90,4 +93,5 @@ int main()
 
     function_clean_up_test();
     undo_redo_vector_memory_leak_test();
+    return undo_redo_fixed_vector_allocation_test() ? 0 : 1;
 }
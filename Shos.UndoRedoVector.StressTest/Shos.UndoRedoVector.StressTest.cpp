@@ -0,0 +1,325 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+#include <memory_resource>
+#include "../undo_redo_vector.h"
+
+using namespace shos;
+
+// Counts the bytes a collection holds for its elements, steps and history.
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+    std::size_t live_bytes = 0;
+    std::size_t peak_bytes = 0;
+
+private:
+    virtual void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        live_bytes += bytes;
+        peak_bytes  = std::max(peak_bytes, live_bytes);
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    virtual void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override
+    {
+        live_bytes -= bytes;
+        std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+    }
+
+    virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+// Element owned by the collection through its clean_up function, so that a missing or a repeated clean-up shows in live_count.
+struct item
+{
+    static std::size_t live_count;
+
+    int value;
+
+    item(int value) : value(value)
+    {
+        live_count++;
+    }
+
+    ~item()
+    {
+        live_count--;
+    }
+};
+
+std::size_t item::live_count = 0;
+
+using collection_type = undo_redo_collection<item*, std::pmr::vector<item*>>;
+
+// Plain model of the collection: every state its history can reach, and the current one.
+// The history has to keep exactly the items of those states alive, and the items a transaction created
+// but did not leave in its state, so it also counts the states holding each value.
+class model
+{
+    std::vector<std::vector<int>>        states;
+    std::vector<std::vector<int>>        transients;
+    std::size_t                          index;
+    std::unordered_map<int, std::size_t> occurrences;
+
+public:
+    model() : states(1), transients(1), index(0)
+    {}
+
+    const std::vector<int>& current() const
+    {
+        return states[index];
+    }
+
+    std::size_t value_count() const
+    {
+        return occurrences.size();
+    }
+
+    void push(std::vector<int> state, const std::vector<int>& created)
+    {
+        for (auto discarded = index + 1; discarded < states.size(); discarded++) {
+            count(states[discarded], false);
+            count(transients[discarded], false);
+        }
+        states.resize(index + 1);
+        transients.resize(index + 1);
+
+        std::vector<int> transient;
+        std::copy_if(created.begin(), created.end(), std::back_inserter(transient), [&](int value) { return std::find(state.begin(), state.end(), value) == state.end(); });
+        count(state, true);
+        count(transient, true);
+        states.push_back(std::move(state));
+        transients.push_back(std::move(transient));
+        index++;
+    }
+
+    bool undo()
+    {
+        if (index == 0)
+            return false;
+        index--;
+        return true;
+    }
+
+    bool redo()
+    {
+        if (index + 1 == states.size())
+            return false;
+        index++;
+        return true;
+    }
+
+    void reset()
+    {
+        states.assign(1, {});
+        transients.assign(1, {});
+        index = 0;
+        occurrences.clear();
+    }
+
+private:
+    void count(const std::vector<int>& state, bool add)
+    {
+        for (auto value : state) {
+            if (add)
+                occurrences[value]++;
+            else if (--occurrences[value] == 0)
+                occurrences.erase(value);
+        }
+    }
+};
+
+// Runs random push_back / insert / erase / update / clear / transaction / undo / redo sequences.
+// When checking, the collection is compared with the model after every operation.
+class stress_driver
+{
+    struct rollback
+    {};
+
+    const bool          check;
+    std::mt19937        random;
+    counting_resource   resource;
+    collection_type     collection;
+    model               reference;
+    int                 next_value;
+    std::vector<int>    created;
+    std::size_t         operation_count;
+
+public:
+    stress_driver(bool check, unsigned seed)
+        : check(check), random(seed), collection([](item* element) { delete element; }, &resource), next_value(0), operation_count(0)
+    {}
+
+    std::size_t get_live_bytes() const
+    {
+        return resource.live_bytes;
+    }
+
+    std::size_t get_peak_bytes() const
+    {
+        return resource.peak_bytes;
+    }
+
+    void run(std::size_t count)
+    {
+        for (std::size_t index = 0; index < count; index++) {
+            step();
+            operation_count++;
+            if (check)
+                verify();
+        }
+    }
+
+    // Drops the history and the elements; every element has to be cleaned up exactly once by then.
+    void reset()
+    {
+        collection.reset();
+        reference.reset();
+        if (item::live_count != 0)
+            fail("clean_up is unbalanced after reset");
+    }
+
+private:
+    void step()
+    {
+        std::vector<int> state;
+        if (check)
+            state = reference.current();
+        created.clear();
+
+        auto kind = std::uniform_int_distribution<int>(0, 99)(random);
+        if (kind < 60) {
+            edit(state);
+            push(std::move(state));
+        } else if (kind < 72) {
+            auto count = std::uniform_int_distribution<int>(1, 8)(random);
+            try {
+                collection_type::transaction transaction(collection);
+                for (int index = 0; index < count; index++)
+                    edit(state);
+                if (kind >= 70)
+                    throw rollback();
+            } catch (const rollback&) {
+                return;
+            }
+            push(std::move(state));
+        } else if (kind < 73) {
+            if (collection.size() == 0)
+                return;
+            collection.clear();
+            push({});
+        } else if (kind < 88) {
+            auto undone = collection.undo();
+            if (check && undone != reference.undo())
+                fail("undo");
+        } else {
+            auto redone = collection.redo();
+            if (check && redone != reference.redo())
+                fail("redo");
+        }
+    }
+
+    // Applies one random edit to the collection and, when checking, to state. Large collections are more likely to shrink.
+    void edit(std::vector<int>& state)
+    {
+        auto size = collection.size();
+        auto kind = size == 0 ? 0 : std::uniform_int_distribution<int>(0, size > 64 ? 9 : 6)(random);
+        auto value = next_value++;
+        if (check && kind < 5)
+            created.push_back(value);
+        if (kind < 2) {
+            collection.push_back(new item(value));
+            if (check)
+                state.push_back(value);
+            return;
+        }
+
+        auto index = std::uniform_int_distribution<std::size_t>(0, size - 1)(random);
+        if (kind < 3) {
+            collection.insert(std::next(collection.begin(), index), new item(value));
+            if (check)
+                state.insert(state.begin() + index, value);
+        } else if (kind < 5) {
+            collection.update(std::next(collection.begin(), index), new item(value));
+            if (check)
+                state[index] = value;
+        } else {
+            collection.erase(std::next(collection.begin(), index));
+            if (check)
+                state.erase(state.begin() + index);
+        }
+    }
+
+    void push(std::vector<int> state)
+    {
+        if (check)
+            reference.push(std::move(state), created);
+    }
+
+    void verify()
+    {
+        const auto& state = reference.current();
+        if (collection.size() != state.size())
+            fail("size");
+        for (std::size_t index = 0; index < state.size(); index++) {
+            if (collection[index]->value != state[index])
+                fail("element");
+        }
+        if (item::live_count < reference.value_count())
+            fail("clean_up removed an element still in use");
+        if (item::live_count > reference.value_count())
+            fail("clean_up missed an element no longer in use");
+    }
+
+    void fail(const char* what) const
+    {
+        std::printf("FAILED: %s at operation %zu\n", what, operation_count);
+        std::exit(1);
+    }
+};
+
+template <typename TFunction>
+double measure(TFunction function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs rounds of operation_count operations, each ending with reset().
+// The bytes still held after each reset show whether the history engine leaks or keeps growing.
+void stress(const char* name, bool check, std::size_t operation_count, std::size_t round_count, unsigned seed)
+{
+    stress_driver driver(check, seed);
+    auto          base_bytes = driver.get_live_bytes();
+
+    std::printf("%s: %zu rounds of %zu operations, seed %u\n", name, round_count, operation_count, seed);
+    for (std::size_t round = 0; round < round_count; round++) {
+        auto time  = measure([&] { driver.run(operation_count); });
+        auto bytes = driver.get_live_bytes();
+        driver.reset();
+        std::printf("  round %2zu: %10.0f ops/s, %10zu bytes held, %10zu bytes peak, %+zd bytes after reset\n",
+                    round + 1, operation_count / time * 1000.0, bytes, driver.get_peak_bytes(),
+                    static_cast<std::ptrdiff_t>(driver.get_live_bytes() - base_bytes));
+    }
+}
+
+// Usage: Shos.UndoRedoVector.StressTest [operations per round [seed]]
+int main(int argc, char* argv[])
+{
+    std::size_t operation_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    unsigned    seed            = argc > 2 ? static_cast<unsigned>(std::strtoul(argv[2], nullptr, 10)) : 1;
+
+    stress("model checked", true , operation_count, 5 , seed);
+    stress("soak"         , false, operation_count, 20, seed);
+    std::printf("passed\n");
+}
@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <algorithm>
+#include "..\undo_redo_change_stream.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ShosUndoRedoVectorTest
+{
+    using namespace shos;
+
+    TEST_CLASS(undo_redo_change_stream_test)
+    {
+        static bool same(undo_redo_vector<int>& left, undo_redo_vector<int>& right)
+        {
+            return left.size() == right.size() && std::equal(left.begin(), left.end(), right.begin());
+        }
+
+    public:
+        TEST_METHOD(replicate)
+        {
+            std::vector<std::byte>  pipe;
+            undo_redo_vector<int>   source;
+            undo_redo_change_stream stream(source, [&](const std::byte* bytes, std::size_t size) { pipe.insert(pipe.end(), bytes, bytes + size); });
+            undo_redo_vector<int>   target;
+            undo_redo_replica       replica(target);
+
+            auto transfer = [&] {
+                // Delivers the bytes in small pieces, as a pipe may.
+                std::size_t frame_count = 0;
+                for (std::size_t first = 0; first < pipe.size(); first += 3)
+                    frame_count += replica.read(pipe.data() + first, std::min<std::size_t>(3, pipe.size() - first));
+                pipe.clear();
+                return frame_count;
+            };
+
+            source.push_back(300);
+            source.push_back(100);
+            {
+                undo_redo_vector<int>::transaction transaction(source);
+                source.insert(source.begin(), 200);
+                source.update(std::next(source.begin(), 2), -100);
+                source.erase(std::next(source.begin(), 1));
+            }
+            source.sort(source.begin(), source.end());
+            Assert::AreEqual<size_t>(transfer(), 4UL);
+            Assert::IsTrue(same(source, target));
+
+            source.undo();
+            source.undo();
+            Assert::AreEqual<size_t>(pipe.size(), 4UL);
+            source.redo();
+            Assert::AreEqual<size_t>(transfer(), 3UL);
+            Assert::IsTrue(same(source, target));
+
+            while (source.undo())
+                Assert::IsTrue(target.undo());
+            Assert::IsFalse(target.undo());
+            Assert::AreEqual<size_t>(target.size(), 0UL);
+            pipe.clear();
+
+            source.push_back(400);
+            source.push_back(500);
+            source.reverse(source.begin(), source.end());
+            transfer();
+            Assert::IsTrue(same(source, target));
+            Assert::IsFalse(target.can_redo());
+            Assert::IsTrue(target.undo());
+            Assert::IsTrue(target.undo());
+            Assert::IsTrue(target.undo());
+            Assert::IsFalse(target.undo());
+        }
+
+        TEST_METHOD(rollback_and_reset)
+        {
+            std::vector<std::byte>  pipe;
+            undo_redo_vector<int>   source;
+            undo_redo_change_stream stream(source, [&](const std::byte* bytes, std::size_t size) { pipe.insert(pipe.end(), bytes, bytes + size); });
+            undo_redo_vector<int>   target;
+            undo_redo_replica       replica(target);
+
+            source.push_back(100);
+            try {
+                undo_redo_vector<int>::transaction transaction(source);
+                source.push_back(200);
+                source.update(source.begin(), 300);
+                throw std::runtime_error("failed");
+            } catch (const std::runtime_error&) {
+            }
+            source.push_back(400);
+            replica.read(pipe.data(), pipe.size());
+            pipe.clear();
+            Assert::IsTrue(same(source, target));
+
+            source.reset();
+            source.push_back(500);
+            replica.read(pipe.data(), pipe.size());
+            Assert::IsTrue(same(source, target));
+            Assert::IsTrue(target.undo());
+            Assert::IsFalse(target.undo());
+
+            Assert::ExpectException<std::logic_error>([&] { undo_redo_change_stream other(source, [](const std::byte*, std::size_t) {}); });
+        }
+
+        TEST_METHOD(corrupted_stream)
+        {
+            undo_redo_vector<int> target;
+            undo_redo_replica     replica(target);
+            target.push_back(100);
+
+            // Reads a commit frame of one change; an insert or update puts 0.
+            auto read = [&](std::size_t position, change_stream::change_kind kind) {
+                std::byte payload[change_stream::max_varint_size + 6] = { static_cast<std::byte>(change_stream::frame_kind::commit), std::byte{ 1 } };
+                auto      size = 2 + change_stream::write_varint(payload + 2, position << 2 | static_cast<std::size_t>(kind));
+                size += sizeof(int);
+                std::vector<std::byte> frame(change_stream::max_varint_size);
+                frame.resize(change_stream::write_varint(frame.data(), size));
+                frame.insert(frame.end(), payload, payload + size);
+                return replica.read(frame.data(), frame.size());
+            };
+
+            Assert::ExpectException<std::runtime_error>([&] { read(1, change_stream::change_kind::erase ); });
+            Assert::ExpectException<std::runtime_error>([&] { read(1, change_stream::change_kind::update); });
+            Assert::ExpectException<std::runtime_error>([&] { read(2, change_stream::change_kind::insert); });
+            Assert::ExpectException<std::runtime_error>([&] { read(std::size_t(1) << 40, change_stream::change_kind::insert); });
+            Assert::AreEqual<size_t>(target.size(), 1UL);
+            Assert::AreEqual<int>(target[0], 100);
+
+            Assert::AreEqual<size_t>(read(1, change_stream::change_kind::insert), 1UL);
+            Assert::IsTrue(std::vector<int>(target.begin(), target.end()) == std::vector<int>{ 100, 0 });
+        }
+    };
+}
@@ -0,0 +1,131 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "..\undo_redo_chunked_vector.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ShosUndoRedoVectorTest
+{
+    using namespace shos;
+
+    TEST_CLASS(undo_redo_chunked_vector_test)
+    {
+        template <typename TCollection>
+        static std::vector<int> values(const TCollection& collection)
+        {
+            return std::vector<int>(collection.cbegin(), collection.cend());
+        }
+
+        static constexpr int chunk_size = static_cast<int>(chunked_vector<int>::chunk_size);
+
+    public:
+        TEST_METHOD(chunked_vector_edit)
+        {
+            chunked_vector<int> sequence;
+            std::vector<int>    expected;
+            for (int value = 0; value < 3 * chunk_size; value++) {
+                sequence.push_back(value);
+                expected.push_back(value);
+            }
+            Assert::AreEqual<size_t>(sequence.chunk_count(), 3UL);
+
+            // Inserting in the middle splits the chunk that has grown too large.
+            for (int value = 0; value < chunk_size + 1; value++) {
+                sequence.insert(sequence.begin() + chunk_size + 10, -value);
+                expected.insert(expected.begin() + chunk_size + 10, -value);
+            }
+            Assert::AreEqual<size_t>(sequence.chunk_count(), 4UL);
+            Assert::IsTrue(values(sequence) == expected);
+
+            sequence.erase(sequence.begin() + 5, sequence.begin() + 3 * chunk_size);
+            expected.erase(expected.begin() + 5, expected.begin() + 3 * chunk_size);
+            Assert::IsTrue(values(sequence) == expected);
+
+            sequence.erase(sequence.begin());
+            expected.erase(expected.begin());
+            sequence[1] = 100;
+            expected[1] = 100;
+            Assert::IsTrue(values(sequence) == expected);
+
+            sequence.resize(3);
+            expected.resize(3);
+            Assert::IsTrue(values(sequence) == expected);
+            sequence.clear();
+            Assert::IsTrue(sequence.empty());
+        }
+
+        TEST_METHOD(copy_on_write)
+        {
+            chunked_vector<int> sequence;
+            for (int value = 0; value < 2 * chunk_size; value++)
+                sequence.push_back(value);
+
+            auto copy = sequence;
+            copy[0] = -1;
+            copy.insert(copy.begin() + chunk_size, -2);
+            Assert::AreEqual<int>(sequence[0], 0);
+            Assert::AreEqual<int>(sequence[chunk_size], chunk_size);
+            Assert::AreEqual<size_t>(sequence.size(), 2UL * chunk_size);
+            Assert::AreEqual<int>(copy[0], -1);
+            Assert::AreEqual<int>(copy[chunk_size], -2);
+        }
+
+        TEST_METHOD(fork)
+        {
+            undo_redo_chunked_vector<int> array;
+            for (int value = 0; value < 4 * chunk_size; value++)
+                array.push_back(value);
+            array.update(array.begin(), -1);
+
+            auto copy = array.fork();
+            copy.erase(copy.begin() + 2 * chunk_size);
+            Assert::AreEqual<size_t>(copy .size(), 4UL * chunk_size - 1);
+            Assert::AreEqual<size_t>(array.size(), 4UL * chunk_size);
+            Assert::AreEqual<int>(array[2 * chunk_size], 2 * chunk_size);
+
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<int>(array[0], 0);
+            Assert::AreEqual<int>(copy [0], -1);
+
+            Assert::IsTrue(copy.undo());
+            Assert::IsTrue(copy.undo());
+            Assert::IsTrue(values(copy) == values(array));
+            Assert::IsTrue(copy.redo());
+            Assert::AreEqual<int>(copy [0], -1);
+            Assert::AreEqual<int>(array[0], 0);
+        }
+
+        // Each parallel algorithm gets chunks of the fork's own, so none of its threads copies a shared chunk.
+        TEST_METHOD(parallel_after_fork)
+        {
+            undo_redo_chunked_vector<int> array;
+            for (int value = 0; value < 4 * chunk_size; value++)
+                array.push_back(value);
+            array.set_parallel_threshold(chunk_size);
+            auto expected = values(array);
+
+            auto copy = array.fork();
+            copy.transform(copy.begin(), copy.end(), [](int value) { return -value; });
+            copy.sort(copy.begin(), copy.end());
+            {
+                undo_redo_chunked_vector<int>::transaction transaction(copy);
+                for (int index = 0; index < 4 * chunk_size; index += 2)
+                    copy.update(copy.begin() + index, 0);
+            }
+            Assert::IsTrue(values(array) == expected);
+            Assert::AreEqual<int>(copy[0], 0);
+            Assert::AreEqual<int>(copy[1], 2 - 4 * chunk_size);
+
+            Assert::IsTrue(copy.undo());
+            Assert::AreEqual<int>(copy[0], 1 - 4 * chunk_size);
+            Assert::IsTrue(copy.undo());
+            Assert::IsTrue(copy.undo());
+            Assert::IsTrue(values(copy) == expected);
+            Assert::IsTrue(copy.redo());
+            Assert::IsTrue(copy.redo());
+            Assert::IsTrue(copy.redo());
+            Assert::AreEqual<int>(copy[1], 2 - 4 * chunk_size);
+            Assert::IsTrue(values(array) == expected);
+        }
+    };
+}
@@ -0,0 +1,114 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <string>
+#include "..\undo_redo_content_hash.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ShosUndoRedoVectorTest
+{
+    using namespace shos;
+
+    TEST_CLASS(undo_redo_content_hash_test)
+    {
+        // The same value, computed from scratch.
+        static std::uint64_t rehash(undo_redo_vector<int>& array)
+        {
+            undo_redo_vector<int> copy;
+            copy.append_range(std::vector<int>(array.begin(), array.end()));
+            return undo_redo_content_hash<int>(copy).value();
+        }
+
+    public:
+        TEST_METHOD(order_aware)
+        {
+            undo_redo_vector<int>       array;
+            undo_redo_content_hash<int> hash(array);
+            auto                        empty = hash.value();
+
+            array.push_back(100);
+            array.push_back(200);
+            auto first = hash.value();
+            Assert::IsTrue(first != empty);
+
+            array.sort(array.begin(), array.end(), std::greater<>());
+            Assert::IsTrue(hash.value() != first);
+            array.reverse(array.begin(), array.end());
+            Assert::IsTrue(hash.value() == first);
+
+            array.push_back(0);
+            auto with_zero = hash.value();
+            array.push_back(0);
+            Assert::IsTrue(hash.value() != with_zero);
+        }
+
+        TEST_METHOD(follows_history)
+        {
+            undo_redo_vector<int>       array;
+            undo_redo_content_hash<int> hash(array);
+            std::vector<std::uint64_t>  values { hash.value() };
+
+            for (int value = 0; value < 200; value++) {
+                switch (value % 4) {
+                    case 0:
+                    case 1:
+                        array.insert(std::next(array.begin(), array.size() / 2), value);
+                        break;
+                    case 2:
+                        array.update(std::next(array.begin(), value % array.size()), -value);
+                        break;
+                    case 3:
+                        array.erase(std::next(array.begin(), value % array.size()));
+                        break;
+                }
+                Assert::AreEqual<std::uint64_t>(hash.value(), rehash(array));
+                values.push_back(hash.value());
+            }
+
+            for (auto index = values.size() - 1; index > 0; index--) {
+                Assert::IsTrue(array.undo());
+                Assert::AreEqual<std::uint64_t>(hash.value(), values[index - 1]);
+            }
+            {
+                undo_redo_vector<int>::transaction transaction(array);
+                while (array.redo())
+                    ;
+            }
+            Assert::AreEqual<std::uint64_t>(hash.value(), values.back());
+
+            array.reset();
+            Assert::AreEqual<std::uint64_t>(hash.value(), values.front());
+        }
+
+        TEST_METHOD(follows_erase_if)
+        {
+            undo_redo_vector<int>       array;
+            undo_redo_content_hash<int> hash(array);
+            for (int value = 0; value < 100; value++)
+                array.push_back(value);
+            auto before = hash.value();
+
+            array.erase_if([](int value) { return value % 7 == 0 || value > 90; });
+            Assert::AreEqual<std::uint64_t>(hash.value(), rehash(array));
+            array.undo();
+            Assert::AreEqual<std::uint64_t>(hash.value(), before);
+            array.redo();
+            Assert::AreEqual<std::uint64_t>(hash.value(), rehash(array));
+        }
+
+        TEST_METHOD(custom_hash)
+        {
+            using length_hash = std::function<std::size_t(const std::string&)>;
+
+            undo_redo_vector<std::string>                                                array;
+            undo_redo_content_hash<std::string, std::vector<std::string>, length_hash> hash(array, [](const std::string& text) { return text.size(); });
+
+            array.push_back("red");
+            auto red = hash.value();
+            array.update(array.begin(), "tan");
+            Assert::AreEqual<std::uint64_t>(hash.value(), red);
+            array.update(array.begin(), "blue");
+            Assert::IsTrue(hash.value() != red);
+        }
+    };
+}
@@ -0,0 +1,73 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <string>
+#include "..\undo_redo_element_store.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ShosUndoRedoVectorTest
+{
+    using namespace shos;
+
+    TEST_CLASS(undo_redo_element_store_test)
+    {
+    public:
+        TEST_METHOD(intern)
+        {
+            element_store<std::string> store;
+            auto red   = store.intern("red");
+            auto blue  = store.intern("blue");
+            auto other = store.intern("red");
+
+            Assert::IsTrue(red == other);
+            Assert::IsTrue(red != blue);
+            Assert::AreEqual<std::string>(*other, "red");
+            Assert::AreEqual<size_t>(other->size(), 3UL);
+            Assert::AreEqual<size_t>(store.size(), 2UL);
+
+            blue = red;
+            Assert::AreEqual<size_t>(store.size(), 1UL);
+        }
+
+        TEST_METHOD(history_keeps_distinct_values)
+        {
+            element_store<std::string>             store;
+            undo_redo_interned_vector<std::string> array;
+
+            for (int count = 0; count < 100; count++) {
+                array.push_back(store.intern("red"));
+                array.update(array.begin(), store.intern(count % 2 == 0 ? "blue" : "red"));
+                array.erase(array.begin());
+            }
+            Assert::AreEqual<size_t>(array.size(), 0UL);
+            Assert::AreEqual<size_t>(store.size(), 2UL);
+
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<std::string>(*array[0], "red");
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<std::string>(*array[0], "red");
+
+            array.reset();
+            Assert::AreEqual<size_t>(store.size(), 0UL);
+        }
+
+        TEST_METHOD(transaction)
+        {
+            element_store<int>             store;
+            undo_redo_interned_vector<int> array;
+            {
+                undo_redo_interned_vector<int>::transaction transaction(array);
+                for (int value = 0; value < 10; value++)
+                    array.push_back(store.intern(value % 3));
+                array.update(array.begin(), store.intern(5));
+            }
+            Assert::AreEqual<size_t>(store.size(), 4UL);
+
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<size_t>(array.size(), 0UL);
+            Assert::IsTrue(array.redo());
+            Assert::AreEqual<int>(*array[0], 5);
+            Assert::AreEqual<int>(*array[9], 0);
+        }
+    };
+}
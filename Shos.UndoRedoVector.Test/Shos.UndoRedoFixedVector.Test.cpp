@@ -0,0 +1,124 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "..\undo_redo_fixed_vector.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ShosUndoRedoVectorTest
+{
+    using namespace shos;
+
+    constexpr int constant_sum()
+    {
+        undo_redo_fixed_vector<int, 8> array;
+        array.push_back(1);
+        array.push_back(2);
+        array.push_back(3);
+        array.update(array.begin(), 10);
+        array.erase(array.begin() + 1);
+        array.undo();
+        array.undo();
+        array.redo();
+
+        int sum = 0;
+        for (auto value : array)
+            sum += value;
+        return sum;
+    }
+
+    static_assert(constant_sum() == 15);
+
+    TEST_CLASS(undo_redo_fixed_vector_test)
+    {
+        template <std::size_t Capacity, std::size_t HistoryCapacity>
+        static std::vector<int> values(const undo_redo_fixed_vector<int, Capacity, HistoryCapacity>& array)
+        {
+            return std::vector<int>(array.begin(), array.end());
+        }
+
+    public:
+        TEST_METHOD(fixed_vector)
+        {
+            undo_redo_fixed_vector<int, 4> array;
+            array.push_back(100);
+            array.push_back(300);
+            array.insert(array.begin() + 1, 200);
+            array.update(array.begin(), 50);
+            array.erase(array.begin() + 2);
+            Assert::IsTrue(values(array) == std::vector<int>{ 50, 200 });
+
+            array.undo();
+            Assert::IsTrue(values(array) == std::vector<int>{ 50, 200, 300 });
+            array.undo();
+            array.undo();
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 300 });
+            array.redo();
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 200, 300 });
+
+            array.push_back(400);
+            Assert::IsFalse(array.can_redo());
+            Assert::ExpectException<std::length_error>([&] { array.push_back(500); });
+            Assert::ExpectException<std::out_of_range>([&] { array.erase_at(4); });
+        }
+
+        TEST_METHOD(ring_history)
+        {
+            undo_redo_fixed_vector<int, 16, 4> array;
+            for (int value = 0; value < 6; value++)
+                array.push_back(value);
+
+            for (int count = 0; count < 4; count++)
+                Assert::IsTrue(array.undo());
+            Assert::IsFalse(array.undo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 0, 1 });
+
+            while (array.redo())
+                ;
+            Assert::AreEqual<size_t>(6, array.size());
+        }
+
+        TEST_METHOD(fixed_transaction)
+        {
+            undo_redo_fixed_vector<int, 16, 6> array;
+            array.push_back(1);
+            {
+                undo_redo_fixed_vector<int, 16, 6>::transaction transaction(array);
+                array.push_back(2);
+                {
+                    undo_redo_fixed_vector<int, 16, 6>::transaction inner(array);
+                    array.push_back(3);
+                    array.update(array.begin(), 10);
+                }
+            }
+            Assert::IsTrue(values(array) == std::vector<int>{ 10, 2, 3 });
+            array.undo();
+            Assert::IsTrue(values(array) == std::vector<int>{ 1 });
+            array.redo();
+            Assert::IsTrue(values(array) == std::vector<int>{ 10, 2, 3 });
+
+            try {
+                undo_redo_fixed_vector<int, 16, 6>::transaction transaction(array);
+                array.erase(array.begin());
+                throw std::runtime_error("failed");
+            } catch (const std::runtime_error&) {
+            }
+            Assert::IsTrue(values(array) == std::vector<int>{ 10, 2, 3 });
+
+            // Overwrites the first push_back, then the whole history with a transaction that does not fit in it.
+            array.push_back(4);
+            array.push_back(5);
+            array.push_back(6);
+            for (int count = 0; count < 4; count++)
+                Assert::IsTrue(array.undo());
+            Assert::IsFalse(array.undo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 1 });
+
+            while (array.redo())
+                ;
+            array.push_back(7);
+            array.clear();
+            Assert::IsFalse(array.can_undo());
+            Assert::AreEqual<size_t>(0, array.size());
+        }
+    };
+}
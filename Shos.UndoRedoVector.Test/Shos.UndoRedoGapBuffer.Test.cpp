@@ -0,0 +1,123 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <string>
+#include "..\undo_redo_gap_buffer.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ShosUndoRedoVectorTest
+{
+    using namespace shos;
+
+    TEST_CLASS(undo_redo_gap_buffer_test)
+    {
+        template <typename TCollection>
+        static std::string text(const TCollection& collection)
+        {
+            return std::string(collection.cbegin(), collection.cend());
+        }
+
+    public:
+        TEST_METHOD(gap_buffer_edit)
+        {
+            gap_buffer<char> buffer;
+            for (auto character : std::string("hello world"))
+                buffer.push_back(character);
+
+            buffer.insert(buffer.begin() + 5, ',');
+            Assert::AreEqual<std::string>(text(buffer), "hello, world");
+
+            buffer.erase(buffer.begin());
+            buffer.insert(buffer.begin(), 'H');
+            buffer.erase(buffer.end() - 1);
+            Assert::AreEqual<std::string>(text(buffer), "Hello, worl");
+            Assert::AreEqual<size_t>(buffer.size(), 11UL);
+            Assert::AreEqual<char>(buffer[7], 'w');
+
+            for (int count = 0; count < 100; count++)
+                buffer.insert(buffer.begin() + 2, 'x');
+            Assert::AreEqual<size_t>(buffer.size(), 111UL);
+            Assert::AreEqual<char>(buffer[1], 'e');
+            Assert::AreEqual<char>(buffer[101], 'x');
+            Assert::AreEqual<char>(buffer[102], 'l');
+
+            buffer.clear();
+            Assert::IsTrue(buffer.empty());
+        }
+
+        TEST_METHOD(typing_and_undo)
+        {
+            undo_redo_gap_buffer<char> editor;
+            for (auto character : std::string("abcdef"))
+                editor.push_back(character);
+
+            auto cursor = std::size_t(2);
+            for (auto character : std::string("XYZ"))
+                editor.insert(editor.begin() + cursor++, character);
+            Assert::AreEqual<std::string>(text(editor), "abXYZcdef");
+
+            editor.erase(editor.begin() + --cursor);
+            editor.erase(editor.begin() + --cursor);
+            Assert::AreEqual<std::string>(text(editor), "abXcdef");
+
+            editor.update(editor.begin() + 5, 'E');
+            Assert::AreEqual<std::string>(text(editor), "abXcdEf");
+
+            Assert::IsTrue(editor.undo());
+            Assert::IsTrue(editor.undo());
+            Assert::IsTrue(editor.undo());
+            Assert::AreEqual<std::string>(text(editor), "abXYZcdef");
+
+            Assert::IsTrue(editor.undo());
+            Assert::IsTrue(editor.undo());
+            Assert::IsTrue(editor.undo());
+            Assert::AreEqual<std::string>(text(editor), "abcdef");
+
+            while (editor.redo())
+                ;
+            Assert::AreEqual<std::string>(text(editor), "abXcdEf");
+            Assert::AreEqual<char>(editor[5], 'E');
+        }
+
+        TEST_METHOD(paste)
+        {
+            undo_redo_gap_buffer<char> editor;
+            editor.append_range(std::string("hello"));
+            editor.insert(editor.begin() + 2, '-');
+            editor.append_range(std::string(" world"));
+            Assert::AreEqual<std::string>(text(editor), "he-llo world");
+
+            Assert::IsTrue(editor.undo());
+            Assert::AreEqual<std::string>(text(editor), "he-llo");
+            editor.append_range(std::string("!"));
+            Assert::IsTrue(editor.undo());
+            Assert::IsTrue(editor.undo());
+            Assert::IsTrue(editor.undo());
+            Assert::IsTrue(editor.cbegin() == editor.cend());
+
+            Assert::IsTrue(editor.redo());
+            Assert::IsTrue(editor.redo());
+            Assert::AreEqual<std::string>(text(editor), "he-llo");
+        }
+
+        TEST_METHOD(delete_selection)
+        {
+            undo_redo_gap_buffer<char> editor;
+            editor.append_range(std::string("a quick brown fox"));
+            editor.insert(editor.begin() + 1, '!');
+            Assert::AreEqual<size_t>(editor.erase_if([](char character) { return character == ' ' || character == '!'; }), 4UL);
+            Assert::AreEqual<std::string>(text(editor), "aquickbrownfox");
+
+            editor.erase_indices(std::vector<std::size_t>{ 13, 0, 6 });
+            Assert::AreEqual<std::string>(text(editor), "quickrownfo");
+
+            Assert::IsTrue(editor.undo());
+            Assert::AreEqual<std::string>(text(editor), "aquickbrownfox");
+            Assert::IsTrue(editor.undo());
+            Assert::AreEqual<std::string>(text(editor), "a! quick brown fox");
+            Assert::IsTrue(editor.redo());
+            Assert::IsTrue(editor.redo());
+            Assert::AreEqual<std::string>(text(editor), "quickrownfo");
+        }
+    };
+}
@@ -0,0 +1,147 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "..\undo_redo_grid_index.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ShosUndoRedoVectorTest
+{
+    using namespace shos;
+
+    TEST_CLASS(undo_redo_grid_index_test)
+    {
+        struct shape
+        {
+            int            id;
+            grid_rectangle bounds;
+
+            bool operator==(const shape& other) const
+            {
+                return id == other.id;
+            }
+        };
+
+        static grid_rectangle bounds_of(const shape& shape)
+        {
+            return shape.bounds;
+        }
+
+        static std::vector<int> ids(std::vector<shape> shapes)
+        {
+            std::vector<int> ids;
+            std::transform(shapes.begin(), shapes.end(), std::back_inserter(ids), [](const shape& shape) { return shape.id; });
+            std::sort(ids.begin(), ids.end());
+            return ids;
+        }
+
+        static std::vector<int> scan(undo_redo_vector<shape>& shapes, const grid_rectangle& area)
+        {
+            std::vector<shape> found;
+            std::copy_if(shapes.begin(), shapes.end(), std::back_inserter(found), [&](const shape& shape) { return shape.bounds.intersects(area); });
+            return ids(found);
+        }
+
+    public:
+        TEST_METHOD(query_point)
+        {
+            undo_redo_vector<shape> shapes;
+            undo_redo_grid_index<shape> index(shapes, 10.0, bounds_of);
+
+            shapes.push_back({ 1, {  0.0,  0.0,  5.0,  5.0 } });
+            shapes.push_back({ 2, {  3.0,  3.0, 25.0, 25.0 } });
+            shapes.push_back({ 3, { 40.0, 40.0, 45.0, 45.0 } });
+
+            Assert::IsTrue(ids(index.query(4.0, 4.0)) == std::vector<int>{ 1, 2 });
+            Assert::IsTrue(ids(index.query(20.0, 20.0)) == std::vector<int>{ 2 });
+            Assert::IsTrue(index.query(30.0, 30.0).empty());
+        }
+
+        TEST_METHOD(query_rectangle)
+        {
+            undo_redo_vector<shape> shapes;
+            undo_redo_grid_index<shape> index(shapes, 10.0, bounds_of);
+
+            for (int id = 0; id < 100; id++) {
+                auto x = (id % 10) * 7.0;
+                auto y = (id / 10) * 7.0;
+                shapes.push_back({ id, { x, y, x + 12.0, y + 3.0 } });
+            }
+            // Beyond the cells numbered by 32-bit integers.
+            shapes.push_back({ 100, { 1e30, -1e30, 1e30 + 1.0, -1e30 + 1.0 } });
+
+            grid_rectangle areas[] = { { 0.0, 0.0, 100.0, 100.0 }, { 15.0, 15.0, 16.0, 16.0 }, { -5.0, 20.0, 33.0, 41.0 },
+                                       { -1e300, -1e300, 1e300, 1e300 }, { 1e29, -1e31, 1e31, -1e29 } };
+            for (const auto& area : areas)
+                Assert::IsTrue(ids(index.query(area)) == scan(shapes, area));
+        }
+
+        TEST_METHOD(undo_redo)
+        {
+            undo_redo_vector<shape> shapes;
+            shapes.push_back({ 1, { 0.0, 0.0, 5.0, 5.0 } });
+
+            undo_redo_grid_index<shape> index(shapes, 10.0, bounds_of);
+            grid_rectangle all = { -100.0, -100.0, 100.0, 100.0 };
+            Assert::IsTrue(ids(index.query(all)) == std::vector<int>{ 1 });
+
+            shapes.push_back({ 2, { 50.0, 50.0, 55.0, 55.0 } });
+            shapes.update(shapes.begin(), { 1, { 60.0, 60.0, 65.0, 65.0 } });
+            Assert::IsTrue(ids(index.query(62.0, 62.0)) == std::vector<int>{ 1 });
+            Assert::IsTrue(index.query(2.0, 2.0).empty());
+
+            Assert::IsTrue(shapes.undo());
+            Assert::IsTrue(ids(index.query(2.0, 2.0)) == std::vector<int>{ 1 });
+            Assert::IsTrue(index.query(62.0, 62.0).empty());
+
+            Assert::IsTrue(shapes.redo());
+            Assert::IsTrue(ids(index.query(62.0, 62.0)) == std::vector<int>{ 1 });
+
+            {
+                undo_redo_vector<shape>::transaction transaction(shapes);
+                shapes.erase(shapes.begin());
+                shapes.push_back({ 3, { -20.0, -20.0, -15.0, -15.0 } });
+            }
+            Assert::IsTrue(ids(index.query(all)) == std::vector<int>{ 2, 3 });
+
+            Assert::IsTrue(shapes.undo());
+            Assert::IsTrue(ids(index.query(all)) == std::vector<int>{ 1, 2 });
+            Assert::IsTrue(ids(index.query(all)) == scan(shapes, all));
+
+            shapes.clear();
+            Assert::IsTrue(index.query(all).empty());
+            Assert::IsTrue(shapes.undo());
+            Assert::IsTrue(ids(index.query(all)) == std::vector<int>{ 1, 2 });
+
+            shapes.reset();
+            Assert::IsTrue(index.query(all).empty());
+        }
+
+        TEST_METHOD(huge_elements)
+        {
+            constexpr auto infinity = std::numeric_limits<double>::infinity();
+
+            undo_redo_vector<shape> shapes;
+            undo_redo_grid_index<shape> index(shapes, 1.0, bounds_of);
+
+            shapes.push_back({ 1, { 0.0, 0.0, 5.0, 5.0 } });
+            shapes.push_back({ 2, { -1e300, -1e300, 1e300, 1e300 } });
+            shapes.push_back({ 3, { -infinity, -infinity, infinity, infinity } });
+            shapes.push_back({ 4, { 0.0, -infinity, 0.5, infinity } });
+            Assert::IsTrue(ids(index.query(0.25, 1e100)) == std::vector<int>{ 2, 3, 4 });
+            Assert::IsTrue(ids(index.query(3.0, 3.0)) == std::vector<int>{ 1, 2, 3 });
+
+            grid_rectangle areas[] = { { 1.0, 1.0, 2.0, 2.0 }, { -1e30, 7.0, -1e29, 8.0 }, { -infinity, -infinity, infinity, infinity } };
+            for (const auto& area : areas)
+                Assert::IsTrue(ids(index.query(area)) == scan(shapes, area));
+
+            shapes.update(std::next(shapes.begin(), 1), { 2, { 10.0, 10.0, 11.0, 11.0 } });
+            shapes.erase(std::next(shapes.begin(), 2));
+            Assert::IsTrue(ids(index.query(3.0, 3.0)) == std::vector<int>{ 1 });
+            Assert::IsTrue(shapes.undo());
+            Assert::IsTrue(shapes.undo());
+            Assert::IsTrue(ids(index.query(3.0, 3.0)) == std::vector<int>{ 1, 2, 3 });
+            for (const auto& area : areas)
+                Assert::IsTrue(ids(index.query(area)) == scan(shapes, area));
+        }
+    };
+}
@@ -0,0 +1,157 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <string>
+#include <random>
+#include "..\undo_redo_hash_index.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ShosUndoRedoVectorTest
+{
+    using namespace shos;
+
+    TEST_CLASS(undo_redo_hash_index_test)
+    {
+        static void assert_consistent(undo_redo_vector<int>& array, undo_redo_hash_index<int>& index)
+        {
+            for (std::size_t position = 0; position < array.size(); position++) {
+                Assert::IsTrue(index.contains(array[position]));
+                Assert::AreEqual<std::size_t>(std::distance(array.begin(), std::find(array.begin(), array.end(), array[position])),
+                                              std::distance(array.begin(), index.find(array[position])));
+                Assert::AreEqual<std::size_t>(std::count(array.begin(), array.end(), array[position]), index.count(array[position]));
+            }
+        }
+
+    public:
+        TEST_METHOD(find)
+        {
+            undo_redo_vector<int> array;
+            array.push_back(100);
+            array.push_back(200);
+
+            undo_redo_hash_index<int> index(array);
+            array.push_back(300);
+
+            Assert::IsTrue(index.find(100) == array.begin());
+            Assert::IsTrue(index.find(300) == std::next(array.begin(), 2));
+            Assert::IsTrue(index.find(400) == array.end());
+            Assert::IsTrue(index.contains(200));
+            Assert::IsFalse(index.contains(400));
+        }
+
+        TEST_METHOD(erase_value)
+        {
+            undo_redo_vector<int> array;
+            undo_redo_hash_index<int> index(array);
+            for (int value = 0; value < 10; value++)
+                array.push_back(value * 100);
+
+            Assert::IsTrue(index.erase_value(300));
+            Assert::IsFalse(index.erase_value(300));
+            Assert::AreEqual<size_t>(array.size(), 9UL);
+            Assert::IsTrue(index.find(400) == std::next(array.begin(), 3));
+            assert_consistent(array, index);
+
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(index.find(300) == std::next(array.begin(), 3));
+            Assert::IsTrue(index.find(400) == std::next(array.begin(), 4));
+            assert_consistent(array, index);
+        }
+
+        TEST_METHOD(undo_redo)
+        {
+            undo_redo_vector<int> array;
+            undo_redo_hash_index<int> index(array);
+
+            array.push_back(100);
+            array.push_back(200);
+            array.push_back(100);
+            array.push_back(300);
+            {
+                undo_redo_vector<int>::transaction transaction(array);
+                array.erase(array.begin());
+                array.update(std::next(array.begin(), 1), 200);
+                array.erase(std::next(array.begin(), 1));
+                array.push_back(100);
+            }
+            assert_consistent(array, index);
+            Assert::AreEqual<std::size_t>(2, index.count(100) + index.count(300));
+
+            Assert::IsTrue(array.undo());
+            assert_consistent(array, index);
+            Assert::AreEqual<std::size_t>(2, index.count(100));
+
+            Assert::IsTrue(array.redo());
+            assert_consistent(array, index);
+
+            array.sort(array.begin(), array.end());
+            assert_consistent(array, index);
+            Assert::IsTrue(array.undo());
+            assert_consistent(array, index);
+
+            array.transform(array.begin(), array.end(), [](int value) { return value + 1; });
+            Assert::IsFalse(index.contains(200));
+            assert_consistent(array, index);
+            Assert::IsTrue(array.undo());
+            assert_consistent(array, index);
+
+            array.clear();
+            Assert::IsFalse(index.contains(200));
+            Assert::IsTrue(array.undo());
+            assert_consistent(array, index);
+
+            array.reset();
+            Assert::IsFalse(index.contains(200));
+        }
+
+        TEST_METHOD(middle_edits)
+        {
+            undo_redo_vector<int> array;
+            for (int value = 0; value < 200; value++)
+                array.push_back(value % 50);
+            undo_redo_hash_index<int> index(array);
+
+            std::mt19937 random(1);
+            for (int count = 0; count < 300; count++) {
+                auto position = random() % (array.size() + 1);
+                switch (random() % 4) {
+                    case 0:
+                        array.insert(std::next(array.begin(), position), static_cast<int>(random() % 50));
+                        break;
+                    case 1:
+                        index.erase_value(static_cast<int>(random() % 50));
+                        break;
+                    case 2:
+                        if (position < array.size())
+                            array.update(std::next(array.begin(), position), static_cast<int>(random() % 50));
+                        break;
+                    default:
+                        array.undo();
+                        break;
+                }
+            }
+            assert_consistent(array, index);
+
+            while (array.undo())
+                ;
+            assert_consistent(array, index);
+            while (array.redo())
+                ;
+            assert_consistent(array, index);
+        }
+
+        TEST_METHOD(key)
+        {
+            undo_redo_vector<std::string> array;
+            undo_redo_hash_index<std::string, std::size_t> index(array, [](const std::string& text) { return text.size(); });
+
+            array.push_back("a");
+            array.push_back("abc");
+            array.push_back("ab");
+
+            Assert::IsTrue(index.find(3) == std::next(array.begin(), 1));
+            Assert::IsTrue(index.erase_value(1));
+            Assert::IsTrue(index.find(2) == std::next(array.begin(), 1));
+        }
+    };
+}
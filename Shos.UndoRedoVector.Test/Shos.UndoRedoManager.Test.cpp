@@ -0,0 +1,123 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include <string>
+#include "..\undo_redo_vector.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ShosUndoRedoVectorTest
+{
+    using namespace shos;
+
+    TEST_CLASS(undo_redo_manager_test)
+    {
+    public:
+        TEST_METHOD(transaction)
+        {
+            undo_redo_manager             manager;
+            undo_redo_vector<int>         shapes;
+            undo_redo_vector<std::string> styles;
+            manager.add(shapes);
+            manager.add(styles);
+
+            {
+                undo_redo_manager::transaction transaction(manager);
+                shapes.push_back(100);
+                styles.push_back("red");
+                shapes.push_back(200);
+            }
+            Assert::AreEqual<size_t>(shapes.size(), 2UL);
+            Assert::AreEqual<size_t>(styles.size(), 1UL);
+
+            Assert::IsTrue(styles.undo());
+            Assert::AreEqual<size_t>(shapes.size(), 0UL);
+            Assert::AreEqual<size_t>(styles.size(), 0UL);
+            Assert::IsFalse(manager.can_undo());
+            Assert::IsTrue(shapes.can_redo());
+
+            Assert::IsTrue(manager.redo());
+            Assert::AreEqual<size_t>(shapes.size(), 2UL);
+            Assert::AreEqual<std::string>(styles[0], "red");
+            Assert::IsFalse(shapes.redo());
+        }
+
+        TEST_METHOD(interleaved_steps)
+        {
+            undo_redo_manager             manager;
+            undo_redo_vector<int>         shapes;
+            undo_redo_vector<std::string> styles;
+            manager.add(shapes);
+            manager.add(styles);
+
+            shapes.push_back(100);
+            styles.push_back("red");
+            shapes.update(shapes.begin(), 200);
+
+            Assert::IsTrue(manager.undo());
+            Assert::AreEqual<int>(shapes[0], 100);
+            Assert::IsTrue(manager.undo());
+            Assert::AreEqual<size_t>(styles.size(), 0UL);
+            Assert::AreEqual<size_t>(shapes.size(), 1UL);
+
+            styles.push_back("blue");
+            Assert::IsFalse(manager.can_redo());
+            Assert::IsFalse(shapes.can_redo());
+
+            Assert::IsTrue(shapes.undo());
+            Assert::IsTrue(shapes.undo());
+            Assert::AreEqual<size_t>(shapes.size(), 0UL);
+            Assert::IsFalse(manager.undo());
+        }
+
+        TEST_METHOD(rollback_on_exception)
+        {
+            undo_redo_manager             manager;
+            undo_redo_vector<int>         shapes;
+            undo_redo_vector<std::string> styles;
+            manager.add(shapes);
+            manager.add(styles);
+            shapes.push_back(100);
+
+            try {
+                undo_redo_manager::transaction transaction(manager);
+                shapes.erase(shapes.begin());
+                styles.push_back("red");
+                throw std::runtime_error("failed");
+            } catch (const std::runtime_error&) {
+            }
+            Assert::AreEqual<size_t>(shapes.size(), 1UL);
+            Assert::AreEqual<size_t>(styles.size(), 0UL);
+
+            Assert::IsTrue(manager.undo());
+            Assert::AreEqual<size_t>(shapes.size(), 0UL);
+            Assert::IsFalse(manager.undo());
+        }
+
+        TEST_METHOD(remove)
+        {
+            undo_redo_manager     manager;
+            undo_redo_vector<int> shapes;
+            manager.add(shapes);
+            {
+                undo_redo_vector<std::string> styles;
+                manager.add(styles);
+                {
+                    undo_redo_manager::transaction transaction(manager);
+                    shapes.push_back(100);
+                    styles.push_back("red");
+                }
+                styles.push_back("blue");
+            }
+
+            Assert::IsTrue(manager.undo());
+            Assert::AreEqual<size_t>(shapes.size(), 0UL);
+            Assert::IsFalse(manager.undo());
+
+            manager.remove(shapes);
+            shapes.push_back(200);
+            Assert::IsFalse(manager.can_undo());
+            Assert::IsTrue(shapes.undo());
+            Assert::IsFalse(shapes.undo());
+        }
+    };
+}
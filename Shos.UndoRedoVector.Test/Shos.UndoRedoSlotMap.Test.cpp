@@ -0,0 +1,163 @@
+#include "pch.h"
+#include "CppUnitTest.h"
+#include "..\undo_redo_slot_map.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ShosUndoRedoVectorTest
+{
+    using namespace shos;
+
+    TEST_CLASS(undo_redo_slot_map_test)
+    {
+        static std::vector<int> sorted(undo_redo_slot_map<int>& map)
+        {
+            std::vector<int> values(map.begin(), map.end());
+            std::sort(values.begin(), values.end());
+            return values;
+        }
+
+    public:
+        TEST_METHOD(slot_map_handles)
+        {
+            slot_map<int> map;
+            auto handle1 = map.insert(100);
+            auto handle2 = map.insert(200);
+            auto handle3 = map.insert(300);
+
+            map.erase(handle1);
+            Assert::IsFalse(map.contains(handle1));
+            Assert::AreEqual<size_t>(map.size(), 2UL);
+            Assert::AreEqual<int>(map[handle2], 200);
+            Assert::AreEqual<int>(map[handle3], 300);
+
+            auto handle4 = map.insert(400);
+            Assert::AreEqual<std::uint32_t>(handle4.index, handle1.index);
+            Assert::IsFalse(map.contains(handle1));
+            Assert::IsTrue(map.contains(handle4));
+            Assert::AreEqual<int>(map[handle4], 400);
+        }
+
+        TEST_METHOD(stable_handles)
+        {
+            undo_redo_slot_map<int> map;
+            auto handle1 = map.insert(100);
+            auto handle2 = map.insert(200);
+            auto handle3 = map.insert(300);
+
+            map.erase(handle1);
+            Assert::AreEqual<size_t>(map.size(), 2UL);
+            Assert::IsFalse(map.contains(handle1));
+            Assert::AreEqual<int>(map[handle2], 200);
+            Assert::AreEqual<int>(map[handle3], 300);
+
+            map.update(handle3, 3000);
+            Assert::AreEqual<int>(map[handle3], 3000);
+
+            Assert::IsTrue(map.undo());
+            Assert::AreEqual<int>(map[handle3], 300);
+
+            Assert::IsTrue(map.undo());
+            Assert::IsTrue(map.contains(handle1));
+            Assert::AreEqual<int>(map[handle1], 100);
+            Assert::AreEqual<int>(map[handle2], 200);
+            Assert::IsTrue(sorted(map) == std::vector<int>{ 100, 200, 300 });
+
+            Assert::IsTrue(map.redo());
+            Assert::IsFalse(map.contains(handle1));
+            Assert::IsTrue(map.redo());
+            Assert::AreEqual<int>(map[handle3], 3000);
+
+            Assert::IsTrue(map.undo());
+            Assert::IsTrue(map.undo());
+            Assert::IsTrue(map.undo());
+            Assert::IsFalse(map.contains(handle3));
+            Assert::IsTrue(map.redo());
+            Assert::IsTrue(map.contains(handle3));
+            Assert::AreEqual<int>(map[handle3], 300);
+        }
+
+        TEST_METHOD(iterate_and_group)
+        {
+            undo_redo_slot_map<int> map;
+            for (int value = 1; value <= 5; value++)
+                map.insert(value * 100);
+
+            {
+                undo_redo_slot_map<int>::transaction transaction(map);
+                map.erase(std::next(map.begin(), 1));
+                map.erase(map.begin());
+                map.insert(600);
+            }
+            Assert::IsTrue(sorted(map) == std::vector<int>{ 300, 400, 500, 600 });
+
+            auto handle = map.handle_of(map.cbegin());
+            Assert::AreEqual<int>(map[handle], *map.begin());
+
+            Assert::IsTrue(map.undo());
+            Assert::IsTrue(sorted(map) == std::vector<int>{ 100, 200, 300, 400, 500 });
+            Assert::IsTrue(map.redo());
+            Assert::IsTrue(sorted(map) == std::vector<int>{ 300, 400, 500, 600 });
+
+            map.clear();
+            Assert::AreEqual<size_t>(map.size(), 0UL);
+            Assert::IsTrue(map.undo());
+            Assert::IsTrue(sorted(map) == std::vector<int>{ 300, 400, 500, 600 });
+        }
+
+        TEST_METHOD(released_slots)
+        {
+            undo_redo_slot_map<int> map;
+            auto handle1 = map.insert(100);
+            map.erase(handle1);
+            Assert::IsTrue(map.undo());
+            Assert::IsTrue(map.undo());
+
+            auto handle2 = map.insert(200);
+            auto handle3 = map.insert(300);
+            Assert::AreEqual<std::uint32_t>(handle3.index, handle1.index);
+            Assert::IsFalse(map.contains(handle1));
+            Assert::AreEqual<int>(map[handle2], 200);
+            Assert::AreEqual<int>(map[handle3], 300);
+        }
+
+        TEST_METHOD(stale_handles)
+        {
+            undo_redo_slot_map<int> map;
+            auto handle1 = map.insert(10);
+            map.erase(handle1);
+            Assert::ExpectException<std::out_of_range>([&] { map.update(handle1, 99); });
+            Assert::ExpectException<std::out_of_range>([&] { map[handle1]; });
+
+            // Once the slot is reused, the old handle still does not reach the new element.
+            Assert::IsTrue(map.undo());
+            Assert::IsTrue(map.undo());
+            auto handle2 = map.insert(20);
+            auto handle3 = map.insert(30);
+            Assert::AreEqual<std::uint32_t>(handle3.index, handle1.index);
+            Assert::ExpectException<std::out_of_range>([&] { map.update(handle1, 99); });
+            Assert::ExpectException<std::out_of_range>([&] { map.erase(handle1); });
+            Assert::AreEqual<int>(map[handle2], 20);
+            Assert::AreEqual<int>(map[handle3], 30);
+            Assert::IsTrue(map.undo());
+            Assert::IsFalse(map.contains(handle3));
+        }
+
+        class foo
+        {
+        };
+
+        TEST_METHOD(clean_up)
+        {
+            undo_redo_slot_map<foo*> map([](foo* foo) { delete foo; });
+            auto handle = map.insert(new foo());
+            map.insert(new foo());
+            map.update(handle, new foo());
+            map.erase(handle);
+            map.undo();
+            map.undo();
+            map.insert(new foo());
+            map.reset();
+        }
+    };
+}
@@ -1,5 +1,7 @@
 #include "pch.h"
 #include "CppUnitTest.h"
+#include <deque>
+#include <string>
 #include "..\undo_redo_vector.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -329,6 +331,928 @@ namespace ShosUndoRedoVectorTest
             Assert::AreEqual<int>(array[1], 200);
         }
 
+        TEST_METHOD(version)
+        {
+            undo_redo_vector<int> array;
+            auto version0 = array.version();
+
+            array.push_back(100);
+            auto version1 = array.version();
+            Assert::IsTrue(array.has_changed_since(version0));
+
+            {
+                undo_redo_vector<int>::transaction transaction(array);
+                array.push_back(200);
+                array.push_back(300);
+            }
+            auto version2 = array.version();
+            Assert::IsTrue(version2 > version1);
+
+            {
+                undo_redo_vector<int>::transaction transaction(array);
+            }
+            Assert::AreEqual<size_t>(array.version(), version2);
+
+            array.undo();
+            Assert::AreEqual<size_t>(array.version(), version1);
+            array.undo();
+            Assert::AreEqual<size_t>(array.version(), version0);
+            array.redo();
+            array.redo();
+            Assert::AreEqual<size_t>(array.version(), version2);
+            Assert::IsFalse(array.has_changed_since(version2));
+
+            array.undo();
+            array.push_back(400);
+            Assert::IsTrue(array.version() > version2);
+        }
+
+        TEST_METHOD(save_point)
+        {
+            undo_redo_vector<int> array;
+            Assert::IsFalse(array.is_modified());
+
+            array.push_back(100);
+            array.push_back(200);
+            Assert::IsTrue(array.is_modified());
+
+            array.mark_saved();
+            Assert::IsFalse(array.is_modified());
+
+            array.undo();
+            Assert::IsTrue(array.is_modified());
+            array.redo();
+            Assert::IsFalse(array.is_modified());
+
+            array.push_back(300);
+            Assert::IsTrue(array.is_modified());
+            array.undo();
+            Assert::IsFalse(array.is_modified());
+
+            array.undo();
+            array.push_back(400);
+            Assert::IsTrue(array.is_modified());
+            array.undo();
+            Assert::IsTrue(array.is_modified());
+            array.redo();
+            Assert::IsTrue(array.is_modified());
+
+            array.mark_saved();
+            array.reset();
+            Assert::IsTrue(array.is_modified());
+        }
+
+        TEST_METHOD(insert)
+        {
+            undo_redo_vector<int> array;
+            array.push_back(100);
+            array.push_back(400);
+
+            array.insert(std::next(array.begin(), 1), 200);
+            array.insert(std::next(array.begin(), 2), 300);
+            array.insert(array.begin(), 0);
+            Assert::IsTrue(std::vector<int>(array.begin(), array.end()) == std::vector<int>{ 0, 100, 200, 300, 400 });
+
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(std::vector<int>(array.begin(), array.end()) == std::vector<int>{ 100, 200, 400 });
+
+            Assert::IsTrue(array.redo());
+            Assert::IsTrue(array.redo());
+            Assert::IsTrue(std::vector<int>(array.begin(), array.end()) == std::vector<int>{ 0, 100, 200, 300, 400 });
+        }
+
+        template <typename TCollection>
+        static void check_backend()
+        {
+            using collection_type = undo_redo_collection<int, TCollection>;
+            auto values = [](collection_type& collection) { return std::vector<int>(collection.begin(), collection.end()); };
+
+            collection_type collection;
+            collection.push_back(100);
+            collection.push_back(400);
+            collection.insert(std::next(collection.begin(), 1), 200);
+            collection.insert(std::next(collection.begin(), 2), 300);
+            Assert::IsTrue(values(collection) == std::vector<int>{ 100, 200, 300, 400 });
+
+            collection.update(std::next(collection.begin(), 1), 2000);
+            collection.erase(std::next(collection.begin(), 1));
+            collection.erase(std::next(collection.begin(), 1));
+            Assert::IsTrue(values(collection) == std::vector<int>{ 100, 400 });
+
+            {
+                typename collection_type::transaction transaction(collection);
+                collection.insert(std::next(collection.begin(), 1), 250);
+                collection.erase(collection.begin());
+                collection.push_back(500);
+            }
+            Assert::IsTrue(values(collection) == std::vector<int>{ 250, 400, 500 });
+
+            Assert::IsTrue(collection.undo());
+            Assert::IsTrue(values(collection) == std::vector<int>{ 100, 400 });
+            Assert::IsTrue(collection.undo());
+            Assert::IsTrue(values(collection) == std::vector<int>{ 100, 300, 400 });
+            Assert::IsTrue(collection.undo());
+            Assert::IsTrue(values(collection) == std::vector<int>{ 100, 2000, 300, 400 });
+            Assert::IsTrue(collection.undo());
+            Assert::IsTrue(values(collection) == std::vector<int>{ 100, 200, 300, 400 });
+            Assert::IsTrue(collection.undo());
+            Assert::IsTrue(collection.undo());
+            Assert::IsTrue(values(collection) == std::vector<int>{ 100, 400 });
+
+            while (collection.redo())
+                ;
+            Assert::IsTrue(values(collection) == std::vector<int>{ 250, 400, 500 });
+
+            collection.clear();
+            Assert::AreEqual<size_t>(collection.size(), 0UL);
+            Assert::IsTrue(collection.undo());
+            Assert::IsTrue(values(collection) == std::vector<int>{ 250, 400, 500 });
+
+            collection.undo();
+            collection.push_back(600);
+            Assert::IsTrue(values(collection) == std::vector<int>{ 100, 400, 600 });
+        }
+
+        TEST_METHOD(list_backend)
+        {
+            check_backend<std::list<int>>();
+        }
+
+        TEST_METHOD(deque_backend)
+        {
+            check_backend<std::deque<int>>();
+        }
+
+        TEST_METHOD(list_iterators_survive_undo)
+        {
+            undo_redo_collection<int, std::list<int>> list;
+            list.push_back(100);
+            list.push_back(200);
+            list.push_back(300);
+
+            auto middle = std::next(list.begin(), 1);
+            list.erase(middle);
+            list.undo();
+            Assert::IsTrue(std::next(list.begin(), 1) == middle);
+            Assert::AreEqual<int>(*middle, 200);
+        }
+
+        TEST_METHOD(parallel_group)
+        {
+            const int size = 10000;
+
+            undo_redo_vector<int> array;
+            array.set_parallel_threshold(100);
+            for (int value = 0; value < size; value++)
+                array.push_back(value);
+
+            {
+                undo_redo_vector<int>::transaction transaction(array);
+                for (int index = 0; index < size; index++)
+                    array.update(std::next(array.begin(), index), -index);
+                array.push_back(size);
+                for (int index = 0; index < 200; index++)
+                    array.update(std::next(array.begin(), index % 100), index);
+                array.erase(array.begin());
+            }
+            Assert::AreEqual<size_t>(array.size(), size);
+            Assert::AreEqual<int>(array[0], 101);
+            Assert::AreEqual<int>(array[98], 199);
+            Assert::AreEqual<int>(array[99], -100);
+            Assert::AreEqual<int>(array[size - 2], -(size - 1));
+            Assert::AreEqual<int>(array[size - 1], size);
+
+            for (int count = 0; count < 2; count++) {
+                Assert::IsTrue(array.undo());
+                Assert::AreEqual<size_t>(array.size(), size);
+                for (int index = 0; index < size; index++)
+                    Assert::AreEqual<int>(array[index], index);
+
+                Assert::IsTrue(array.redo());
+                Assert::AreEqual<int>(array[0], 101);
+                Assert::AreEqual<int>(array[99], -100);
+                Assert::AreEqual<int>(array[size - 1], size);
+            }
+        }
+
+        static std::vector<int> values(undo_redo_vector<int>& array)
+        {
+            return std::vector<int>(array.begin(), array.end());
+        }
+
+        TEST_METHOD(sort)
+        {
+            undo_redo_vector<int> array;
+            for (auto value : { 500, 100, 400, 200, 300 })
+                array.push_back(value);
+
+            array.sort(array.begin(), array.end());
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 200, 300, 400, 500 });
+
+            array.sort(array.begin(), array.end());
+            array.sort(std::next(array.begin(), 1), std::next(array.begin(), 4), std::greater<>());
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 400, 300, 200, 500 });
+
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 200, 300, 400, 500 });
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 500, 100, 400, 200, 300 });
+            Assert::IsTrue(array.redo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 200, 300, 400, 500 });
+        }
+
+        TEST_METHOD(stable_sort)
+        {
+            undo_redo_vector<int> array;
+            array.set_parallel_threshold(4);
+            for (auto value : { 31, 12, 21, 11, 32, 22, 13 })
+                array.push_back(value);
+
+            array.stable_sort(array.begin(), array.end(), [](int left, int right) { return left / 10 < right / 10; });
+            Assert::IsTrue(values(array) == std::vector<int>{ 12, 11, 13, 21, 22, 31, 32 });
+
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 31, 12, 21, 11, 32, 22, 13 });
+            Assert::IsTrue(array.redo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 12, 11, 13, 21, 22, 31, 32 });
+        }
+
+        TEST_METHOD(reverse_and_rotate)
+        {
+            undo_redo_vector<int> array;
+            for (auto value : { 100, 200, 300, 400, 500 })
+                array.push_back(value);
+
+            {
+                undo_redo_vector<int>::transaction transaction(array);
+                array.reverse(array.begin(), array.end());
+                array.rotate(std::next(array.begin(), 1), std::next(array.begin(), 2), array.end());
+                array.push_back(600);
+            }
+            Assert::IsTrue(values(array) == std::vector<int>{ 500, 300, 200, 100, 400, 600 });
+
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 200, 300, 400, 500 });
+            Assert::IsTrue(array.redo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 500, 300, 200, 100, 400, 600 });
+        }
+
+        TEST_METHOD(transform)
+        {
+            undo_redo_vector<int> array;
+            for (auto value : { 100, 200, 300, 400, 500 })
+                array.push_back(value);
+
+            array.transform(std::next(array.begin(), 1), std::next(array.begin(), 4), [](int value) { return value + 1; });
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 201, 301, 401, 500 });
+
+            array.update_range(std::next(array.begin(), 3), { 700, 800 });
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 201, 301, 700, 800 });
+
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 201, 301, 401, 500 });
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 200, 300, 400, 500 });
+            Assert::IsTrue(array.redo());
+            Assert::IsTrue(array.redo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 201, 301, 700, 800 });
+            Assert::IsFalse(array.redo());
+        }
+
+        TEST_METHOD(parallel_transform)
+        {
+            undo_redo_vector<int> array;
+            array.set_parallel_threshold(8);
+            for (int value = 0; value < 100; value++)
+                array.push_back(value);
+
+            {
+                undo_redo_vector<int>::transaction transaction(array);
+                array.transform(array.begin(), array.end(), [](int value) { return value * 2; });
+                array.erase(array.begin());
+            }
+            Assert::AreEqual<size_t>(array.size(), 99UL);
+            Assert::AreEqual<int>(array[98], 198);
+
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<size_t>(array.size(), 100UL);
+            for (int value = 0; value < 100; value++)
+                Assert::AreEqual<int>(array[value], value);
+        }
+
+        TEST_METHOD(nested_transaction)
+        {
+            undo_redo_vector<int> array;
+            array.push_back(100);
+            {
+                undo_redo_vector<int>::transaction outer(array);
+                array.push_back(200);
+                {
+                    undo_redo_vector<int>::transaction inner(array);
+                    array.push_back(300);
+                    array.clear();
+                }
+                array.push_back(400);
+            }
+            Assert::AreEqual<size_t>(array.size(), 1UL);
+
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<size_t>(array.size(), 1UL);
+            Assert::AreEqual<int>(array[0], 100);
+            Assert::IsTrue(array.undo());
+            Assert::IsFalse(array.undo());
+        }
+
+        TEST_METHOD(savepoint)
+        {
+            undo_redo_vector<int> array;
+            array.push_back(100);
+            {
+                undo_redo_vector<int>::transaction transaction(array);
+                array.update(array.begin(), 200);
+                auto savepoint = array.savepoint();
+                array.push_back(300);
+                array.erase(array.begin());
+                array.rollback_to(savepoint);
+                Assert::AreEqual<size_t>(array.size(), 1UL);
+                Assert::AreEqual<int>(array[0], 200);
+                array.push_back(400);
+            }
+            Assert::AreEqual<size_t>(array.size(), 2UL);
+
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<size_t>(array.size(), 1UL);
+            Assert::AreEqual<int>(array[0], 100);
+
+            bool thrown = false;
+            try {
+                array.savepoint();
+            } catch (const std::logic_error&) {
+                thrown = true;
+            }
+            Assert::IsTrue(thrown);
+        }
+
+        TEST_METHOD(rollback_on_exception)
+        {
+            undo_redo_vector<int> array;
+            array.push_back(100);
+            auto version = array.version();
+
+            try {
+                undo_redo_vector<int>::transaction transaction(array);
+                array.push_back(200);
+                array.update(array.begin(), 300);
+                throw std::runtime_error("failed");
+            } catch (const std::runtime_error&) {
+            }
+            Assert::AreEqual<size_t>(array.size(), 1UL);
+            Assert::AreEqual<int>(array[0], 100);
+            Assert::AreEqual<std::size_t>(version, array.version());
+            Assert::IsFalse(array.can_redo());
+
+            {
+                undo_redo_vector<int>::transaction outer(array);
+                array.push_back(200);
+                try {
+                    undo_redo_vector<int>::transaction inner(array);
+                    array.push_back(300);
+                    throw std::runtime_error("failed");
+                } catch (const std::runtime_error&) {
+                }
+                array.push_back(400);
+            }
+            Assert::AreEqual<size_t>(array.size(), 3UL);
+            Assert::AreEqual<int>(array[2], 400);
+
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<size_t>(array.size(), 1UL);
+            Assert::IsTrue(array.undo());
+            Assert::IsFalse(array.undo());
+        }
+
+        TEST_METHOD(append_run)
+        {
+            undo_redo_vector<int> array;
+            array.push_back(100);
+            {
+                undo_redo_vector<int>::transaction transaction(array);
+                for (int value = 1; value < 1000; value++)
+                    array.push_back(value * 100);
+                array.update(array.begin(), 0);
+                auto savepoint = array.savepoint();
+                array.push_back(100000);
+                array.push_back(100100);
+                array.rollback_to(savepoint);
+                array.push_back(200000);
+            }
+            Assert::AreEqual<size_t>(array.size(), 1001UL);
+            Assert::AreEqual<int>(array[999], 99900);
+            Assert::AreEqual<int>(array[1000], 200000);
+
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<size_t>(array.size(), 1UL);
+            Assert::AreEqual<int>(array[0], 100);
+            Assert::IsTrue(array.redo());
+            Assert::AreEqual<size_t>(array.size(), 1001UL);
+            Assert::AreEqual<int>(array[0], 0);
+            Assert::AreEqual<int>(array[999], 99900);
+
+            array.append_range(std::vector<int>{ 300000, 300100 });
+            Assert::AreEqual<size_t>(array.size(), 1003UL);
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<size_t>(array.size(), 1001UL);
+        }
+
+        TEST_METHOD(fork)
+        {
+            undo_redo_vector<int> array;
+            array.push_back(100);
+            array.push_back(200);
+            array.update(array.begin(), 150);
+
+            auto copy = array.fork();
+            Assert::IsTrue(values(copy) == std::vector<int>{ 150, 200 });
+
+            copy.push_back(300);
+            Assert::IsTrue(values(copy ) == std::vector<int>{ 150, 200, 300 });
+            Assert::IsTrue(values(array) == std::vector<int>{ 150, 200 });
+
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 200 });
+            Assert::IsTrue(values(copy ) == std::vector<int>{ 150, 200, 300 });
+
+            Assert::IsTrue(copy.undo());
+            Assert::IsTrue(copy.undo());
+            Assert::IsTrue(values(copy) == std::vector<int>{ 100, 200 });
+            Assert::IsTrue(copy.redo());
+            Assert::IsTrue(values(copy) == std::vector<int>{ 150, 200 });
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 200 });
+        }
+
+        TEST_METHOD(fork_outlives_source)
+        {
+            auto source = new undo_redo_vector<int>();
+            source->push_back(100);
+            {
+                undo_redo_vector<int>::transaction transaction(*source);
+                source->push_back(200);
+                source->transform(source->begin(), source->end(), [](int value) { return value + 1; });
+            }
+
+            auto copy = source->fork();
+            source->undo();
+            delete source;
+
+            Assert::IsTrue(values(copy) == std::vector<int>{ 101, 201 });
+            Assert::IsTrue(copy.undo());
+            Assert::IsTrue(values(copy) == std::vector<int>{ 100 });
+            Assert::IsTrue(copy.redo());
+            Assert::IsTrue(values(copy) == std::vector<int>{ 101, 201 });
+
+            auto second = copy.fork();
+            copy.reset();
+            Assert::IsTrue(second.undo());
+            Assert::IsTrue(values(second) == std::vector<int>{ 100 });
+        }
+
+        // A fork copies the pointers to the steps, and a step only when it replays it.
+        TEST_METHOD(fork_shares_steps)
+        {
+            counting_resource resource;
+            {
+                pmr::undo_redo_vector<int> array(&resource);
+                for (int value = 0; value < 10; value++)
+                    array.push_back(value);
+                {
+                    pmr::undo_redo_vector<int>::transaction transaction(array);
+                    for (int value = 0; value < 1000; value++)
+                        array.update(std::next(array.begin(), value % 10), value);
+                }
+
+                auto copy  = array.fork();
+                auto bytes = resource.allocated_bytes;
+                copy.push_back(-1);
+                Assert::IsTrue(resource.allocated_bytes - bytes < 1000 * sizeof(int));
+
+                Assert::IsTrue(copy.undo());
+                Assert::IsTrue(copy.undo());
+                Assert::IsTrue(resource.allocated_bytes - bytes > 1000 * sizeof(int));
+                Assert::IsTrue(std::vector<int>(copy.cbegin(), copy.cend()) == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+                Assert::AreEqual<int>(array[0], 990);
+                Assert::IsTrue(array.undo());
+                Assert::IsTrue(std::equal(array.cbegin(), array.cend(), copy.cbegin(), copy.cend()));
+            }
+            Assert::AreEqual<size_t>(resource.allocated_bytes, 0UL);
+        }
+
+        TEST_METHOD(fork_chain)
+        {
+            undo_redo_vector<int> array;
+            std::vector<int>      expected;
+            for (int value = 0; value < 20; value++) {
+                array.push_back(value);
+                expected.push_back(value);
+            }
+
+            auto copy = array.fork();
+            for (int value = 100; value < 105; value++)
+                copy.push_back(value);
+            auto second = copy.fork();
+
+            for (int count = 0; count < 22; count++)
+                Assert::IsTrue(second.undo());
+            Assert::IsTrue(values(second) == std::vector<int>{ 0, 1, 2 });
+            for (int count = 0; count < 3; count++)
+                Assert::IsTrue(second.redo());
+            second.push_back(-1);
+            Assert::IsFalse(second.can_redo());
+            Assert::IsTrue(values(second) == std::vector<int>{ 0, 1, 2, 3, 4, 5, -1 });
+
+            for (int count = 0; count < 5; count++)
+                Assert::IsTrue(copy.undo());
+            Assert::IsTrue(values(copy ) == expected);
+            Assert::IsTrue(values(array) == expected);
+            while (array.undo())
+                ;
+            Assert::AreEqual<size_t>(array.size(), 0UL);
+            while (copy.redo())
+                ;
+            Assert::AreEqual<size_t>(copy.size(), 25UL);
+
+            while (second.undo())
+                ;
+            Assert::AreEqual<size_t>(second.size(), 0UL);
+            while (second.redo())
+                ;
+            Assert::IsTrue(values(second) == std::vector<int>{ 0, 1, 2, 3, 4, 5, -1 });
+        }
+
+        // The copy a fork makes of a shared step to replay it keeps the version of the step.
+        TEST_METHOD(fork_keeps_versions)
+        {
+            std::function<void(undo_redo_vector<int>&)> operations[] = {
+                [](undo_redo_vector<int>& array) { array.sort(array.begin(), array.end()); },
+                [](undo_redo_vector<int>& array) { array.transform(array.begin(), array.end(), [](int value) { return value * 2; }); },
+                [](undo_redo_vector<int>& array) { array.append_range(std::vector<int>{ 7, 8, 9 }); },
+                [](undo_redo_vector<int>& array) { array.erase_if([](int value) { return value % 2 == 0; }); },
+                [](undo_redo_vector<int>& array) { array.update(array.begin(), 10); },
+                [](undo_redo_vector<int>& array) {
+                    undo_redo_vector<int>::transaction transaction(array);
+                    array.push_back(5);
+                    array.erase(array.begin());
+                }
+            };
+            for (const auto& operation : operations) {
+                undo_redo_vector<int> array;
+                for (auto value : { 3, 1, 4, 1, 5 })
+                    array.push_back(value);
+                operation(array);
+                auto version = array.version();
+                auto after   = values(array);
+
+                auto copy = array.fork();
+                copy.mark_saved();
+                Assert::IsTrue(copy.undo());
+                Assert::IsTrue(copy.is_modified());
+                Assert::IsTrue(copy.redo());
+                Assert::AreEqual<std::size_t>(copy.version(), version);
+                Assert::IsFalse(copy.is_modified());
+                Assert::IsTrue(values(copy) == after);
+            }
+        }
+
+        TEST_METHOD(mixed_group)
+        {
+            undo_redo_vector<int> array;
+            for (auto value : { 300, 100, 200 })
+                array.push_back(value);
+
+            {
+                undo_redo_vector<int>::transaction transaction(array);
+                array.update(array.begin(), 400);
+                array.sort(array.begin(), array.end());
+                array.erase(array.begin());
+                array.push_back(500);
+                array.push_back(600);
+                array.insert(array.begin(), 50);
+                array.reverse(array.begin(), array.end());
+                array.update(array.begin(), 700);
+            }
+            Assert::IsTrue(values(array) == std::vector<int>{ 700, 500, 400, 200, 50 });
+
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 300, 100, 200 });
+            Assert::IsTrue(array.redo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 700, 500, 400, 200, 50 });
+        }
+
+        TEST_METHOD(sliced_undo)
+        {
+            undo_redo_vector<int> array;
+            array.set_parallel_threshold(4);
+            for (int value = 0; value < 10; value++)
+                array.push_back(value);
+            {
+                undo_redo_vector<int>::transaction transaction(array);
+                for (int index = 0; index < 10; index++)
+                    array.update(std::next(array.begin(), index), -index);
+                array.sort(array.begin(), array.end());
+                array.insert(array.begin(), 100);
+                array.erase(std::prev(array.end()));
+            }
+            auto done    = values(array);
+            auto version = array.version();
+
+            int slice_count = 1;
+            while (!array.undo_slice(3)) {
+                Assert::IsTrue(array.is_pending());
+                Assert::AreEqual<size_t>(array.version(), version);
+                slice_count++;
+            }
+            Assert::AreEqual<int>(slice_count, 5);
+            Assert::IsFalse(array.is_pending());
+            Assert::IsTrue(values(array) == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+
+            Assert::IsFalse(array.redo_slice(7));
+            Assert::ExpectException<std::logic_error>([&] { array.undo(); });
+            Assert::ExpectException<std::logic_error>([&] { array.undo_slice(1); });
+            Assert::ExpectException<std::logic_error>([&] { array.push_back(1); });
+            Assert::ExpectException<std::logic_error>([&] { array.update(array.begin(), 1); });
+            Assert::ExpectException<std::logic_error>([&] { array.modify(array.begin(), [](int& value) { value++; }); });
+            Assert::ExpectException<std::logic_error>([&] { array.sort(array.begin(), array.end()); });
+            Assert::ExpectException<std::logic_error>([&] { array.erase_if([](int) { return true; }); });
+            array.cancel_pending();
+            Assert::IsTrue(values(array) == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+
+            Assert::IsFalse(array.redo_slice(5));
+            Assert::IsTrue(array.redo_for(std::chrono::seconds(10)));
+            Assert::IsTrue(values(array) == done);
+            Assert::AreEqual<size_t>(array.version(), version);
+
+            Assert::IsFalse(array.undo_slice(2));
+            Assert::ExpectException<std::logic_error>([&] { array.insert(array.begin(), 1); });
+            Assert::ExpectException<std::logic_error>([&] { array.erase(array.begin()); });
+            array.cancel_pending();
+            Assert::IsTrue(values(array) == done);
+
+            Assert::IsTrue(array.undo_for(std::chrono::seconds(10)));
+            Assert::IsTrue(array.undo_slice(1));
+            Assert::AreEqual<size_t>(array.size(), 9UL);
+        }
+
+        TEST_METHOD(erase_if)
+        {
+            undo_redo_vector<int> array;
+            for (int value = 0; value < 10; value++)
+                array.push_back(value);
+
+            Assert::AreEqual<size_t>(array.erase_if([](int value) { return value % 3 == 0; }), 4UL);
+            Assert::IsTrue(values(array) == std::vector<int>{ 1, 2, 4, 5, 7, 8 });
+            array.undo();
+            Assert::IsTrue(values(array) == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+            array.redo();
+            Assert::IsTrue(values(array) == std::vector<int>{ 1, 2, 4, 5, 7, 8 });
+
+            array.erase_indices(std::vector<std::size_t>{ 5, 0, 2, 0 });
+            Assert::IsTrue(values(array) == std::vector<int>{ 2, 5, 7 });
+            Assert::ExpectException<std::out_of_range>([&] { array.erase_indices(std::vector<std::size_t>{ 3 }); });
+
+            {
+                undo_redo_vector<int>::transaction transaction(array);
+                array.push_back(9);
+                array.erase_if([](int value) { return value < 6; });
+                array.insert(array.begin(), 1);
+            }
+            Assert::IsTrue(values(array) == std::vector<int>{ 1, 7, 9 });
+            Assert::AreEqual<size_t>(array.erase_if([](int) { return false; }), 0UL);
+            array.undo();
+            Assert::IsTrue(values(array) == std::vector<int>{ 2, 5, 7 });
+            array.undo();
+            Assert::IsTrue(values(array) == std::vector<int>{ 1, 2, 4, 5, 7, 8 });
+            array.redo();
+            array.redo();
+            Assert::IsTrue(values(array) == std::vector<int>{ 1, 7, 9 });
+        }
+
+        TEST_METHOD(capacity)
+        {
+            undo_redo_vector<int> array;
+            array.reserve(1000);
+            array.reserve_history(1000);
+            auto reserved = array.stats();
+            Assert::IsTrue(reserved.element_capacity >= 1000 && reserved.step_capacity >= 1000);
+
+            for (int value = 0; value < 1000; value++)
+                array.push_back(value);
+            auto stats = array.stats();
+            Assert::AreEqual<size_t>(stats.element_count, 1000UL);
+            Assert::AreEqual<size_t>(stats.step_count, 1000UL);
+            Assert::AreEqual<size_t>(stats.element_capacity, reserved.element_capacity);
+            Assert::AreEqual<size_t>(stats.step_capacity, reserved.step_capacity);
+
+            // Discarding the redo steps keeps the reservations.
+            for (int count = 0; count < 900; count++)
+                array.undo();
+            array.push_back(-1);
+            stats = array.stats();
+            Assert::AreEqual<size_t>(stats.step_count, 101UL);
+            Assert::AreEqual<size_t>(stats.element_capacity, reserved.element_capacity);
+            Assert::AreEqual<size_t>(stats.step_capacity, reserved.step_capacity);
+
+            // Without them, only the history is shrunk.
+            undo_redo_vector<int> unreserved;
+            for (int value = 0; value < 1000; value++)
+                unreserved.push_back(value);
+            auto element_capacity = unreserved.stats().element_capacity;
+            for (int count = 0; count < 900; count++)
+                unreserved.undo();
+            unreserved.push_back(-1);
+            stats = unreserved.stats();
+            Assert::IsTrue(stats.step_capacity <= undo_redo_vector<int>::default_shrink_factor * stats.step_count);
+            Assert::AreEqual<size_t>(stats.element_capacity, element_capacity);
+
+            array.set_shrink_factor(0);
+            array.reserve(5000);
+            array.clear();
+            Assert::IsTrue(array.stats().element_capacity >= 5000);
+            array.shrink_to_fit();
+            Assert::AreEqual<size_t>(array.stats().element_capacity, 0UL);
+            array.undo();
+            Assert::AreEqual<size_t>(array.size(), 101UL);
+
+            array.set_shrink_factor(undo_redo_vector<int>::default_shrink_factor);
+            array.reset();
+            stats = array.stats();
+            Assert::AreEqual<size_t>(stats.element_capacity, 0UL);
+            Assert::AreEqual<size_t>(stats.step_capacity, 0UL);
+        }
+
+        class counting_resource : public std::pmr::memory_resource
+        {
+        public:
+            std::size_t allocated_bytes = 0;
+            std::size_t allocation_count = 0;
+
+        private:
+            virtual void* do_allocate(std::size_t bytes, std::size_t alignment) override
+            {
+                allocated_bytes += bytes;
+                allocation_count++;
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            }
+
+            virtual void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override
+            {
+                allocated_bytes -= bytes;
+                std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+            }
+
+            virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+            {
+                return this == &other;
+            }
+        };
+
+        TEST_METHOD(memory_resource)
+        {
+            counting_resource resource;
+            auto              default_resource = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+            {
+                pmr::undo_redo_vector<int> array(&resource);
+                array.push_back(300);
+                array.push_back(100);
+                array.append_range(std::vector<int>{ 200, 400 });
+                {
+                    pmr::undo_redo_vector<int>::transaction transaction(array);
+                    array.update(array.begin(), 500);
+                    array.erase(std::prev(array.end()));
+                }
+                array.sort(array.begin(), array.end());
+                array.reverse(array.begin(), array.end());
+                array.transform(array.begin(), array.end(), [](int value) { return value + 1; });
+
+                auto copy = array.fork();
+                copy.push_back(600);
+                Assert::IsTrue(resource.allocation_count > 0);
+
+                while (array.undo())
+                    ;
+                Assert::AreEqual<size_t>(array.size(), 0UL);
+                while (array.redo())
+                    ;
+                Assert::IsTrue(std::vector<int>(array.begin(), array.end()) == std::vector<int>{ 501, 201, 101 });
+            }
+            std::pmr::set_default_resource(default_resource);
+            Assert::AreEqual<size_t>(resource.allocated_bytes, 0UL);
+        }
+
+        TEST_METHOD(modify)
+        {
+            undo_redo_vector<int> array;
+            array.push_back(100);
+            array.push_back(200);
+
+            array.modify(std::next(array.begin(), 1), [](int& value) { value += 50; });
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 250 });
+            {
+                undo_redo_vector<int>::transaction transaction(array);
+                array.modify_at(0, [](int& value) { value *= 3; });
+                array.modify_at(0, [](int& value) { value += 1; });
+            }
+            Assert::IsTrue(values(array) == std::vector<int>{ 301, 250 });
+
+            try {
+                array.modify_at(1, [](int& value) { value = 0; throw std::runtime_error("failed"); });
+            } catch (const std::runtime_error&) {
+            }
+            Assert::IsTrue(values(array) == std::vector<int>{ 301, 250 });
+
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 250 });
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 200 });
+            Assert::IsTrue(array.redo());
+            Assert::IsTrue(values(array) == std::vector<int>{ 100, 250 });
+        }
+
+        // Counts how often it is copied; moving it is free.
+        class counted
+        {
+        public:
+            static inline std::size_t copy_count = 0;
+
+            int value;
+
+            counted(int value = 0) : value(value) {}
+            counted(const counted& other) : value(other.value) { copy_count++; }
+            counted(counted&&) = default;
+            counted& operator=(const counted& other) { value = other.value; copy_count++; return *this; }
+            counted& operator=(counted&&) = default;
+        };
+
+        TEST_METHOD(modify_copies_once)
+        {
+            undo_redo_vector<counted> array;
+            array.push_back(counted(100));
+
+            counted::copy_count = 0;
+            array.modify(array.begin(), [](counted& element) { element.value++; });
+            Assert::AreEqual<size_t>(counted::copy_count, 1UL);
+
+            counted::copy_count = 0;
+            {
+                undo_redo_vector<counted>::transaction transaction(array);
+                array.modify_at(0, [](counted& element) { element.value++; });
+                Assert::AreEqual<size_t>(counted::copy_count, 1UL);
+            }
+
+            counted::copy_count = 0;
+            *array.edit_at(0) = counted(200);
+            Assert::AreEqual<size_t>(counted::copy_count, 1UL);
+
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<int>(array[0].value, 102);
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<int>(array[0].value, 101);
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<int>(array[0].value, 100);
+        }
+
+        TEST_METHOD(edit)
+        {
+            undo_redo_vector<std::string> array;
+            array.push_back("red");
+            array.push_back("blue");
+
+            {
+                auto editor = array.edit(array.begin());
+                editor->append("dish");
+                *editor += " brown";
+            }
+            Assert::AreEqual<std::string>(array[0], "reddish brown");
+
+            try {
+                auto editor = array.edit_at(1);
+                editor->clear();
+                throw std::runtime_error("failed");
+            } catch (const std::runtime_error&) {
+            }
+            Assert::AreEqual<std::string>(array[1], "blue");
+
+            Assert::IsTrue(array.undo());
+            Assert::AreEqual<std::string>(array[0], "red");
+            Assert::IsTrue(array.undo());
+            Assert::IsTrue(array.undo());
+            Assert::IsFalse(array.undo());
+            Assert::IsTrue(array.redo());
+            Assert::IsTrue(array.redo());
+            Assert::IsTrue(array.redo());
+            Assert::AreEqual<std::string>(array[0], "reddish brown");
+            Assert::IsFalse(array.can_redo());
+        }
+
         class foo
         {
             int value;
@@ -366,6 +1290,45 @@ namespace ShosUndoRedoVectorTest
         }
 
 
+        TEST_METHOD(clean_up_span)
+        {
+            std::size_t created_count = 0;
+            std::size_t deleted_count = 0;
+            std::size_t call_count    = 0;
+            {
+                undo_redo_vector<foo*> array([&](std::span<foo* const> pointers) {
+                    std::for_each(pointers.begin(), pointers.end(), [](foo* p) { delete p; });
+                    deleted_count += pointers.size();
+                    call_count++;
+                });
+
+                for (; created_count < 3000; created_count++)
+                    array.push_back(new foo(static_cast<int>(created_count)));
+                for (int count = 0; count < 2000; count++)
+                    array.undo();
+                Assert::AreEqual(std::size_t(0), deleted_count);
+
+                array.push_back(new foo(3000));
+                created_count++;
+                Assert::AreEqual(std::size_t(2000), deleted_count);
+                Assert::AreEqual(std::size_t(2), call_count);
+
+                {
+                    undo_redo_vector<foo*>::transaction transaction(array);
+                    while (array.size() > 1)
+                        array.erase(array.begin());
+                }
+                array.reset();
+                Assert::AreEqual(created_count, deleted_count);
+
+                array.push_back(new foo(3100));
+                array.push_back(new foo(3200));
+                created_count += 2;
+            }
+            Assert::AreEqual(created_count, deleted_count);
+            Assert::AreEqual(std::size_t(5), call_count);
+        }
+
         TEST_METHOD(pointer_vector)
         {
             undo_redo_pointer_vector<foo> array;
@@ -389,6 +1352,33 @@ namespace ShosUndoRedoVectorTest
             array.undo();
             array.redo();
             array.redo();
+
+            array.transform(array.begin(), array.end(), [](foo* p) { return new foo(*p + 1); });
+            array.undo();
+            array.redo();
+            array.undo();
+            array.push_back(new foo(1600));
+
+            array.append_range(std::vector<foo*>{ new foo(1700), new foo(1800) });
+            array.undo();
+            array.redo();
+            array.undo();
+            array.push_back(new foo(1900));
+
+            array.erase_if([](foo* p) { return *p > 1500; });
+            array.undo();
+            array.redo();
+            array.erase_if([](foo* p) { return *p < 1500; });
+            array.undo();
+            array.push_back(new foo(2100));
+
+            try {
+                undo_redo_pointer_vector<foo>::transaction transaction(array);
+                array.push_back(new foo(1800));
+                array.update(array.begin(), new foo(2000));
+                throw std::runtime_error("failed");
+            } catch (const std::runtime_error&) {
+            }
         }
     };
 }
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <iterator>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+#include "undo_redo_vector.h"
+
+namespace shos {
+
+// Binary format shared by undo_redo_change_stream and undo_redo_replica.
+// The stream is a sequence of frames: the payload size as a varint, then the payload.
+// A payload is one frame_kind byte; a commit adds the number of changes as a varint, then the changes.
+// A change is (position << 2 | change_kind) as a varint, followed by the element bytes for an insert or an update.
+namespace change_stream {
+
+enum class frame_kind : std::uint8_t
+{
+    commit,
+    undo  ,
+    redo  ,
+    reset
+};
+
+enum class change_kind : std::uint8_t
+{
+    insert,
+    erase ,
+    update
+};
+
+// Longest varint of a 64 bit value.
+constexpr std::size_t max_varint_size = 10;
+
+inline std::size_t write_varint(std::byte* bytes, std::uint64_t value)
+{
+    std::size_t size = 0;
+    for (; value >= 0x80; value >>= 7)
+        bytes[size++] = static_cast<std::byte>((value & 0x7F) | 0x80);
+    bytes[size++] = static_cast<std::byte>(value);
+    return size;
+}
+
+// Returns false if the varint does not end before last.
+inline bool read_varint(const std::byte*& first, const std::byte* last, std::uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; first != last && shift < 64; shift += 7) {
+        auto byte = std::to_integer<std::uint64_t>(*first++);
+        value    |= (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+} // namespace change_stream
+
+// Observes a collection and writes every recorded step, undo, redo and reset to write() as compact binary frames.
+// The changes of a step are batched and written as one frame when the step is recorded, so a transaction is one frame,
+// and an undo or a redo is a two byte frame however many elements it changes.
+// The collection has to be new, so that the history of the replica starts at the same point.
+template <typename TElement, typename TCollection = std::vector<TElement>>
+class undo_redo_change_stream : public undo_redo_collection<TElement, TCollection>::observer
+{
+    static_assert(std::is_trivially_copyable_v<TElement>, "elements are written as their bytes");
+
+    using collection_type = undo_redo_collection<TElement, TCollection>;
+    using frame_kind      = change_stream::frame_kind;
+    using change_kind     = change_stream::change_kind;
+
+    // The frame header is written just before the changes, into room kept at the front of the buffer.
+    static constexpr std::size_t header_capacity = 2 * change_stream::max_varint_size + 1;
+
+    collection_type&                                         collection;
+    const std::function<void(const std::byte*, std::size_t)> write;
+    std::vector<std::byte>                                   buffer;
+    std::size_t                                              change_count;
+    std::size_t                                              written_bytes;
+
+public:
+    undo_redo_change_stream(collection_type& collection, std::function<void(const std::byte*, std::size_t)> write)
+        : collection(collection), write(write), buffer(header_capacity), change_count(0), written_bytes(0)
+    {
+        static_assert(std::is_integral_v<typename collection_type::position_type>, "the stream addresses elements by index");
+
+        if (collection.size() != 0 || collection.can_undo() || collection.can_redo())
+            throw std::logic_error("an exception occurred");
+
+        collection.add_observer(*this);
+    }
+
+    virtual ~undo_redo_change_stream()
+    {
+        collection.remove_observer(*this);
+    }
+
+    undo_redo_change_stream(const undo_redo_change_stream&)            = delete;
+    undo_redo_change_stream& operator=(const undo_redo_change_stream&) = delete;
+
+    std::size_t get_written_bytes() const
+    {
+        return written_bytes;
+    }
+
+    virtual void on_insert(std::size_t position, const TElement& element) override
+    {
+        add_change(change_kind::insert, position, &element);
+    }
+
+    virtual void on_erase(std::size_t position, const TElement&) override
+    {
+        add_change(change_kind::erase, position, nullptr);
+    }
+
+    virtual void on_update(std::size_t position, const TElement&, const TElement& new_element) override
+    {
+        add_change(change_kind::update, position, &new_element);
+    }
+
+    virtual void on_reset() override
+    {
+        write_frame(frame_kind::reset);
+    }
+
+    virtual void on_commit() override
+    {
+        std::byte header[header_capacity];
+        std::byte payload_header[change_stream::max_varint_size + 1];
+        payload_header[0] = static_cast<std::byte>(frame_kind::commit);
+        auto payload_header_size = 1 + change_stream::write_varint(payload_header + 1, change_count);
+        auto header_size         = change_stream::write_varint(header, payload_header_size + buffer.size() - header_capacity);
+        std::memcpy(header + header_size, payload_header, payload_header_size);
+        header_size += payload_header_size;
+
+        auto first = header_capacity - header_size;
+        std::memcpy(buffer.data() + first, header, header_size);
+        flush(buffer.data() + first, buffer.size() - first);
+        buffer.resize(header_capacity);
+        change_count = 0;
+    }
+
+    // The replica undoes and redoes the step itself, so the changes undo() and redo() report are not written.
+    virtual void on_undo() override
+    {
+        write_frame(frame_kind::undo);
+    }
+
+    virtual void on_redo() override
+    {
+        write_frame(frame_kind::redo);
+    }
+
+private:
+    void add_change(change_kind kind, std::size_t position, const TElement* element)
+    {
+        auto size = buffer.size();
+        buffer.resize(size + change_stream::max_varint_size + (element != nullptr ? sizeof(TElement) : 0));
+        size += change_stream::write_varint(buffer.data() + size, static_cast<std::uint64_t>(position) << 2 | static_cast<std::uint8_t>(kind));
+        if (element != nullptr) {
+            std::memcpy(buffer.data() + size, element, sizeof(TElement));
+            size += sizeof(TElement);
+        }
+        buffer.resize(size);
+        change_count++;
+    }
+
+    // Changes left from a transaction that was rolled back entirely cancel out and are dropped with it.
+    void write_frame(frame_kind kind)
+    {
+        const std::byte frame[] = { std::byte{ 1 }, static_cast<std::byte>(kind) };
+        flush(frame, sizeof(frame));
+        buffer.resize(header_capacity);
+        change_count = 0;
+    }
+
+    void flush(const std::byte* bytes, std::size_t size)
+    {
+        write(bytes, size);
+        written_bytes += size;
+    }
+};
+
+// Applies the frames of an undo_redo_change_stream to a collection, which then holds the same elements
+// and the same history as the source: a commit frame is recorded as one step, and undo and redo frames
+// call undo() and redo(). Bytes may arrive in pieces of any size; a frame is applied once it is complete.
+template <typename TElement, typename TCollection = std::vector<TElement>>
+class undo_redo_replica
+{
+    static_assert(std::is_trivially_copyable_v<TElement>, "elements are read from their bytes");
+
+    using collection_type = undo_redo_collection<TElement, TCollection>;
+    using frame_kind      = change_stream::frame_kind;
+    using change_kind     = change_stream::change_kind;
+
+    collection_type&       collection;
+    std::vector<std::byte> pending;
+
+public:
+    undo_redo_replica(collection_type& collection) : collection(collection)
+    {}
+
+    undo_redo_replica(const undo_redo_replica&)            = delete;
+    undo_redo_replica& operator=(const undo_redo_replica&) = delete;
+
+    // Returns the number of frames applied.
+    std::size_t read(const std::byte* bytes, std::size_t size)
+    {
+        const std::byte* first = bytes;
+        const std::byte* last  = bytes + size;
+        if (!pending.empty()) {
+            pending.insert(pending.end(), first, last);
+            first = pending.data();
+            last  = first + pending.size();
+        }
+
+        std::size_t frame_count = 0;
+        for (;;) {
+            auto          frame = first;
+            std::uint64_t payload_size;
+            if (!change_stream::read_varint(frame, last, payload_size) || static_cast<std::uint64_t>(last - frame) < payload_size)
+                break;
+            apply(frame, frame + payload_size);
+            first = frame + payload_size;
+            frame_count++;
+        }
+
+        // first may point into pending, so the rest is copied out before pending is reused.
+        std::vector<std::byte> rest(first, last);
+        pending.swap(rest);
+        return frame_count;
+    }
+
+private:
+    void apply(const std::byte* first, const std::byte* last)
+    {
+        if (first == last)
+            throw std::runtime_error("change stream");
+
+        switch (static_cast<frame_kind>(*first++)) {
+            case frame_kind::commit: {
+                std::uint64_t count;
+                if (!change_stream::read_varint(first, last, count))
+                    throw std::runtime_error("change stream");
+                if (count == 1) {
+                    apply_change(first, last);
+                } else {
+                    typename collection_type::transaction transaction(collection);
+                    for (std::uint64_t index = 0; index < count; index++)
+                        apply_change(first, last);
+                }
+                break;
+            }
+            case frame_kind::undo:
+                collection.undo();
+                break;
+            case frame_kind::redo:
+                collection.redo();
+                break;
+            case frame_kind::reset:
+                collection.reset();
+                break;
+            default:
+                throw std::runtime_error("change stream");
+        }
+    }
+
+    void apply_change(const std::byte*& first, const std::byte* last)
+    {
+        std::uint64_t code;
+        if (!change_stream::read_varint(first, last, code))
+            throw std::runtime_error("change stream");
+
+        // A corrupted change must not reach past the collection. An insert may go to its end, an erase or update must not.
+        auto kind = static_cast<change_kind>(code & 3);
+        if (kind > change_kind::update || (code >> 2) > collection.size() || (kind != change_kind::insert && (code >> 2) == collection.size()))
+            throw std::runtime_error("change stream");
+
+        auto position = static_cast<std::size_t>(code >> 2);
+        if (kind == change_kind::erase) {
+            collection.erase(std::next(collection.begin(), position));
+            return;
+        }
+
+        TElement element;
+        if (static_cast<std::size_t>(last - first) < sizeof(TElement))
+            throw std::runtime_error("change stream");
+        std::memcpy(&element, first, sizeof(TElement));
+        first += sizeof(TElement);
+
+        if (kind == change_kind::insert)
+            collection.insert(std::next(collection.begin(), position), element);
+        else
+            collection.update(std::next(collection.begin(), position), element);
+    }
+};
+
+} // namespace shos
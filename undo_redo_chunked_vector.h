@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include "undo_redo_vector.h"
+#include "undo_redo_index_iterator.h"
+
+namespace shos {
+
+// Sequence kept in chunks, each held through a shared_ptr. A copy shares every chunk and copies a chunk
+// only when it writes to it, so copying takes O(chunks) and the first write after a copy costs one chunk.
+// As the backend of a collection, it lets fork() pay per chunk: either side's first edit copies one chunk, not all the elements.
+template <typename TElement>
+class chunked_vector
+{
+    using chunk = std::vector<TElement>;
+
+    std::vector<std::shared_ptr<chunk>> chunks;
+    std::vector<std::size_t>            offsets;
+    std::size_t                         element_count;
+
+public:
+    // Appending starts a new chunk at chunk_size elements, and a chunk that grows to twice as many is split.
+    static constexpr std::size_t chunk_size = 1024;
+
+    using value_type     = TElement;
+    using iterator       = index_iterator<chunked_vector, TElement>;
+    using const_iterator = index_iterator<const chunked_vector, const TElement>;
+
+    chunked_vector() : element_count(0)
+    {}
+
+    std::size_t size() const
+    {
+        return element_count;
+    }
+
+    bool empty() const
+    {
+        return element_count == 0;
+    }
+
+    std::size_t chunk_count() const
+    {
+        return chunks.size();
+    }
+
+    // Gives the chunk of its own holding the element, so that it can be written.
+    TElement& operator[](std::size_t index)
+    {
+        auto [position, offset] = locate(index);
+        return writable(position)[offset];
+    }
+
+    const TElement& operator[](std::size_t index) const
+    {
+        auto [position, offset] = locate(index);
+        return (*chunks[position])[offset];
+    }
+
+    iterator begin()
+    {
+        return iterator(this, 0);
+    }
+
+    iterator end()
+    {
+        return iterator(this, size());
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, size());
+    }
+
+    const_iterator cbegin() const
+    {
+        return begin();
+    }
+
+    const_iterator cend() const
+    {
+        return end();
+    }
+
+    void push_back(const TElement& element)
+    {
+        insert(end(), element);
+    }
+
+    iterator insert(const_iterator before, const TElement& element)
+    {
+        auto index = before.get_index();
+        if (index == element_count) {
+            if (chunks.empty() || chunks.back()->size() >= chunk_size) {
+                chunks.push_back(std::make_shared<chunk>());
+                offsets.push_back(element_count);
+            }
+            writable(chunks.size() - 1).push_back(element);
+            element_count++;
+            return iterator(this, index);
+        }
+
+        auto [position, offset] = locate(index);
+        auto& target            = writable(position);
+        target.insert(target.begin() + offset, element);
+        element_count++;
+        if (target.size() >= 2 * chunk_size)
+            split(position);
+        update_offsets(position + 1);
+        return iterator(this, index);
+    }
+
+    iterator erase(const_iterator position)
+    {
+        return erase(position, std::next(position));
+    }
+
+    // Whole chunks in the range are dropped without being copied.
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        auto index = first.get_index();
+        auto count = last.get_index() - index;
+        if (count == 0)
+            return iterator(this, index);
+
+        auto [position, offset] = locate(index);
+        auto start              = position;
+        while (count > 0) {
+            auto erased = std::min(count, chunks[position]->size() - offset);
+            if (erased == chunks[position]->size()) {
+                chunks .erase(chunks .begin() + position);
+                offsets.erase(offsets.begin() + position);
+            } else {
+                auto& target = writable(position);
+                target.erase(target.begin() + offset, target.begin() + offset + erased);
+                position++;
+            }
+            element_count -= erased;
+            count         -= erased;
+            offset         = 0;
+        }
+        update_offsets(start);
+        return iterator(this, index);
+    }
+
+    // Appends default constructed elements or erases the tail, like std::vector::resize.
+    void resize(std::size_t new_size)
+    {
+        if (new_size <= element_count) {
+            erase(begin() + new_size, end());
+            return;
+        }
+        while (element_count < new_size)
+            push_back(TElement());
+    }
+
+    void clear()
+    {
+        chunks .clear();
+        offsets.clear();
+        element_count = 0;
+    }
+
+    // Gives every chunk holding an element of [first, last) to this sequence alone. operator[] on those elements
+    // then writes nothing but the element, so that several threads can call it at once, as the parallel algorithms do.
+    void make_writable(std::size_t first, std::size_t last)
+    {
+        if (first >= last)
+            return;
+        auto end = locate(last - 1).first;
+        for (auto position = locate(first).first; position <= end; position++)
+            writable(position);
+    }
+
+private:
+    // The chunk holding the element at index, and the offset of the element in it.
+    std::pair<std::size_t, std::size_t> locate(std::size_t index) const
+    {
+        auto position = static_cast<std::size_t>(std::upper_bound(offsets.begin(), offsets.end(), index) - offsets.begin()) - 1;
+        return { position, index - offsets[position] };
+    }
+
+    chunk& writable(std::size_t position)
+    {
+        if (chunks[position].use_count() > 1)
+            chunks[position] = std::make_shared<chunk>(*chunks[position]);
+        return *chunks[position];
+    }
+
+    void split(std::size_t position)
+    {
+        auto& source = *chunks[position];
+        auto  half   = std::make_shared<chunk>(std::make_move_iterator(source.begin() + source.size() / 2), std::make_move_iterator(source.end()));
+        source.erase(source.begin() + source.size() / 2, source.end());
+        chunks .insert(chunks .begin() + position + 1, std::move(half));
+        offsets.insert(offsets.begin() + position + 1, 0);
+    }
+
+    void update_offsets(std::size_t first)
+    {
+        for (auto position = first; position < chunks.size(); position++)
+            offsets[position] = position == 0 ? 0 : offsets[position - 1] + chunks[position - 1]->size();
+    }
+};
+
+template <typename TElement>
+using undo_redo_chunked_vector = undo_redo_collection<TElement, chunked_vector<TElement>>;
+
+} // namespace shos
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include "undo_redo_vector.h"
+#include "undo_redo_order_tree.h"
+
+namespace shos {
+
+// Order-aware hash of the whole content of an undo_redo_collection, kept up to date in O(log n) per change.
+// The value is the polynomial sum of hash(element[i]) * base^i modulo 2^61 - 1, so equal contents always give equal values
+// and any history state can be compared with another, or used as a cache key, without looking at the elements.
+// The elements are kept in an order_tree, each subtree aggregating its hash and base^size,
+// so that an insertion or an erasure in the middle, which moves every later element, costs O(log n) as well.
+template <typename TElement, typename TCollection = std::vector<TElement>, typename THash = std::hash<TElement>>
+class undo_redo_content_hash : public undo_redo_collection<TElement, TCollection>::observer
+{
+    static_assert(std::is_integral_v<typename undo_redo_collection<TElement, TCollection>::position_type>, "the hash follows elements by index");
+
+    using collection_type = undo_redo_collection<TElement, TCollection>;
+
+    static constexpr std::uint64_t modulus = (std::uint64_t(1) << 61) - 1;
+    static constexpr std::uint64_t base    = 0x1FDCB3A6E9F7C1B5 % modulus;
+
+    // Hash and base^length of a run of elements. Appending a run adds its hash shifted by the length of the first one.
+    struct run
+    {
+        std::uint64_t hash  = 0;
+        std::uint64_t power = 1;
+
+        static run concat(const run& left, const run& right)
+        {
+            return { reduce(left.hash + multiply(left.power, right.hash)), multiply(left.power, right.power) };
+        }
+    };
+
+    collection_type& collection;
+    const THash      hash_of;
+    order_tree<run>  elements;
+
+public:
+    undo_redo_content_hash(collection_type& collection, THash hash_of = THash())
+        : collection(collection), hash_of(hash_of)
+    {
+        rebuild();
+        collection.add_observer(*this);
+    }
+
+    virtual ~undo_redo_content_hash()
+    {
+        collection.remove_observer(*this);
+    }
+
+    undo_redo_content_hash(const undo_redo_content_hash&)            = delete;
+    undo_redo_content_hash& operator=(const undo_redo_content_hash&) = delete;
+
+    std::uint64_t value() const
+    {
+        return elements.total().hash;
+    }
+
+    virtual void on_insert(std::size_t index, const TElement& element) override
+    {
+        elements.insert(index, run_of(element));
+    }
+
+    virtual void on_erase(std::size_t index, const TElement&) override
+    {
+        elements.erase(index);
+    }
+
+    virtual void on_update(std::size_t index, const TElement&, const TElement& new_element) override
+    {
+        elements.assign(elements.id_at(index), run_of(new_element));
+    }
+
+    virtual void on_reset() override
+    {
+        rebuild();
+    }
+
+private:
+    static std::uint64_t reduce(std::uint64_t value)
+    {
+        value = (value & modulus) + (value >> 61);
+        return value >= modulus ? value - modulus : value;
+    }
+
+    // left * right modulo 2^61 - 1 without a 128 bit product: the operands are split at bit 31 and 2^61 is folded back as 1.
+    static std::uint64_t multiply(std::uint64_t left, std::uint64_t right)
+    {
+        auto left_high  = left  >> 31;
+        auto left_low   = left  & 0x7FFFFFFF;
+        auto right_high = right >> 31;
+        auto right_low  = right & 0x7FFFFFFF;
+        auto middle     = left_high * right_low + left_low * right_high;
+        return reduce((left_high * right_high << 1) + (middle >> 30) + ((middle & 0x3FFFFFFF) << 31) + reduce(left_low * right_low));
+    }
+
+    // The hash of a single element is never zero, so that runs of elements that hash to zero still count.
+    run run_of(const TElement& element) const
+    {
+        return { static_cast<std::uint64_t>(hash_of(element)) % (modulus - 1) + 1, base };
+    }
+
+    void rebuild()
+    {
+        elements.clear();
+        for (auto iterator = collection.cbegin(); iterator != collection.cend(); ++iterator)
+            elements.push_back(run_of(*iterator));
+    }
+};
+
+} // namespace shos
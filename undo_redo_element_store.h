@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <functional>
+#include <unordered_map>
+#include "undo_redo_vector.h"
+
+namespace shos {
+
+// Keeps one immutable copy of each distinct value, keyed by THash, and hands out reference counted handles to it.
+// A collection of handles and its undo steps then retain memory for the distinct values only,
+// however many times a value is removed, added again or updated.
+// The store has to outlive every handle it has handed out.
+template <typename TElement, typename THash = std::hash<TElement>>
+class element_store
+{
+    using entries_type = std::unordered_map<TElement, std::size_t, THash>;
+    using entry_type   = typename entries_type::value_type;
+
+    entries_type entries;
+
+public:
+    class handle
+    {
+        friend class element_store;
+
+        element_store* store;
+        entry_type*    entry;
+
+        handle(element_store* store, entry_type* entry) : store(store), entry(entry)
+        {
+            entry->second++;
+        }
+
+    public:
+        handle() : store(nullptr), entry(nullptr)
+        {}
+
+        handle(const handle& other) : store(other.store), entry(other.entry)
+        {
+            if (entry != nullptr)
+                entry->second++;
+        }
+
+        // Moves leave the reference counts alone, so that swapping handles is safe from several threads.
+        handle(handle&& other) noexcept : store(other.store), entry(other.entry)
+        {
+            other.store = nullptr;
+            other.entry = nullptr;
+        }
+
+        handle& operator=(handle other) noexcept
+        {
+            std::swap(store, other.store);
+            std::swap(entry, other.entry);
+            return *this;
+        }
+
+        ~handle()
+        {
+            // Erased through an iterator, since the key is part of the node being erased.
+            if (entry != nullptr && --entry->second == 0)
+                store->entries.erase(store->entries.find(entry->first));
+        }
+
+        const TElement& operator*() const
+        {
+            return entry->first;
+        }
+
+        const TElement* operator->() const
+        {
+            return &entry->first;
+        }
+
+        // Equal values share one entry, so comparing handles is comparing values.
+        bool operator==(const handle& other) const
+        {
+            return entry == other.entry;
+        }
+
+        bool operator!=(const handle& other) const
+        {
+            return entry != other.entry;
+        }
+    };
+
+    element_store() = default;
+
+    element_store(const element_store&)            = delete;
+    element_store& operator=(const element_store&) = delete;
+
+    handle intern(const TElement& element)
+    {
+        return handle(this, &*entries.try_emplace(element, 0).first);
+    }
+
+    // Number of distinct values referenced by live handles.
+    std::size_t size() const
+    {
+        return entries.size();
+    }
+};
+
+template <typename TElement, typename THash = std::hash<TElement>>
+using undo_redo_interned_vector = undo_redo_vector<typename element_store<TElement, THash>::handle>;
+
+} // namespace shos
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <cstddef>
+#include <array>
+#include <utility>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+
+namespace shos {
+
+// Undo / redo vector that never allocates: up to Capacity elements and HistoryCapacity steps are kept inline.
+// The history is a ring buffer: when it is full, the oldest undoable operation (a whole transaction, if it was one)
+// is overwritten. Everything but the transaction class can be used in constant expressions.
+template <typename TElement, std::size_t Capacity, std::size_t HistoryCapacity = Capacity>
+class undo_redo_fixed_vector
+{
+    static_assert(Capacity > 0 && HistoryCapacity > 0, "the capacities must not be zero");
+    static_assert(std::is_default_constructible_v<TElement>, "elements are kept in an array");
+
+    enum class operation_type
+    {
+        add   ,
+        remove,
+        update
+    };
+
+    // joined is set on every step of a transaction but its first one.
+    struct undo_step
+    {
+        operation_type operation;
+        std::size_t    position;
+        TElement       element;
+        bool           joined;
+    };
+
+    std::array<TElement, Capacity>         elements;
+    std::size_t                            element_count;
+    std::array<undo_step, HistoryCapacity> steps;
+    std::size_t                            first_step;
+    std::size_t                            step_count;
+    std::size_t                            undo_steps_count;
+    std::size_t                            dropped_count;
+    std::size_t                            transaction_depth;
+    std::size_t                            transaction_first;
+
+public:
+    using value_type     = TElement;
+    using iterator       = const TElement*;
+    using const_iterator = const TElement*;
+
+    constexpr undo_redo_fixed_vector()
+        : elements(), element_count(0), steps(), first_step(0), step_count(0), undo_steps_count(0), dropped_count(0)
+        , transaction_depth(0), transaction_first(0)
+    {}
+
+    constexpr const TElement& operator[](std::size_t index) const
+    {
+        return elements[index];
+    }
+
+    constexpr std::size_t size() const
+    {
+        return element_count;
+    }
+
+    static constexpr std::size_t capacity()
+    {
+        return Capacity;
+    }
+
+    static constexpr std::size_t history_capacity()
+    {
+        return HistoryCapacity;
+    }
+
+    constexpr const_iterator begin() const
+    {
+        return elements.data();
+    }
+
+    constexpr const_iterator end() const
+    {
+        return elements.data() + element_count;
+    }
+
+    constexpr const_iterator cbegin() const
+    {
+        return begin();
+    }
+
+    constexpr const_iterator cend() const
+    {
+        return end();
+    }
+
+    constexpr void push_back(const TElement& element)
+    {
+        insert_at(element_count, element);
+    }
+
+    constexpr void insert(const_iterator before, const TElement& element)
+    {
+        insert_at(before - begin(), element);
+    }
+
+    constexpr void erase(const_iterator iterator)
+    {
+        erase_at(iterator - begin());
+    }
+
+    constexpr void update(const_iterator iterator, const TElement& element)
+    {
+        update_at(iterator - begin(), element);
+    }
+
+    constexpr void insert_at(std::size_t position, const TElement& element)
+    {
+        if (element_count == Capacity)
+            throw std::length_error("undo_redo_fixed_vector");
+        if (position > element_count)
+            throw std::out_of_range("undo_redo_fixed_vector");
+
+        insert_element(position, element);
+        record(operation_type::add, position, TElement());
+    }
+
+    constexpr void erase_at(std::size_t position)
+    {
+        if (position >= element_count)
+            throw std::out_of_range("undo_redo_fixed_vector");
+
+        record(operation_type::remove, position, erase_element(position));
+    }
+
+    constexpr void update_at(std::size_t position, const TElement& element)
+    {
+        if (position >= element_count)
+            throw std::out_of_range("undo_redo_fixed_vector");
+
+        TElement old_element = std::move(elements[position]);
+        elements[position]   = element;
+        record(operation_type::update, position, std::move(old_element));
+    }
+
+    constexpr void clear()
+    {
+        begin_transaction();
+        while (element_count > 0)
+            erase_at(element_count - 1);
+        end_transaction();
+    }
+
+    // Drops the history and the elements.
+    constexpr void reset()
+    {
+        while (element_count > 0)
+            elements[--element_count] = TElement();
+        while (step_count > 0)
+            steps[index_of(--step_count)].element = TElement();
+        first_step        = 0;
+        undo_steps_count  = 0;
+        dropped_count     = 0;
+        transaction_depth = 0;
+    }
+
+    constexpr bool can_undo() const
+    {
+        return undo_steps_count > 0 && transaction_depth == 0;
+    }
+
+    constexpr bool can_redo() const
+    {
+        return undo_steps_count < step_count && transaction_depth == 0;
+    }
+
+    constexpr bool undo()
+    {
+        if (!can_undo())
+            return false;
+
+        while (toggle(index_of(--undo_steps_count)).joined && undo_steps_count > 0)
+            ;
+        return true;
+    }
+
+    constexpr bool redo()
+    {
+        if (!can_redo())
+            return false;
+
+        do {
+            toggle(index_of(undo_steps_count++));
+        } while (undo_steps_count < step_count && steps[index_of(undo_steps_count)].joined);
+        return true;
+    }
+
+    // Transactions nest, and the outermost one is undone and redone as one operation.
+    // A transaction that does not fit in the history overwrites the whole of it and cannot be undone.
+    constexpr std::size_t begin_transaction()
+    {
+        if (transaction_depth++ == 0)
+            transaction_first = dropped_count + undo_steps_count;
+        return dropped_count + undo_steps_count;
+    }
+
+    constexpr void end_transaction()
+    {
+        if (transaction_depth == 0)
+            throw std::logic_error("an exception occurred");
+
+        transaction_depth--;
+    }
+
+    // Undoes and discards what the open transaction recorded after savepoint, as far as the history still holds it.
+    constexpr void rollback_to(std::size_t savepoint)
+    {
+        if (transaction_depth == 0)
+            throw std::logic_error("an exception occurred");
+
+        while (dropped_count + undo_steps_count > savepoint && undo_steps_count > 0) {
+            toggle(index_of(--undo_steps_count));
+            steps[index_of(undo_steps_count)].element = TElement();
+            step_count = undo_steps_count;
+        }
+    }
+
+    // Rolls back its own steps if it is left by an exception.
+    class transaction
+    {
+        undo_redo_fixed_vector& collection;
+        const std::size_t       savepoint;
+        const int               uncaught_exceptions;
+
+    public:
+        transaction(undo_redo_fixed_vector& collection)
+            : collection(collection), savepoint(collection.begin_transaction()), uncaught_exceptions(std::uncaught_exceptions())
+        {}
+
+        virtual ~transaction()
+        {
+            if (std::uncaught_exceptions() > uncaught_exceptions)
+                collection.rollback_to(savepoint);
+            collection.end_transaction();
+        }
+    };
+
+private:
+    constexpr std::size_t index_of(std::size_t step) const
+    {
+        return (first_step + step) % HistoryCapacity;
+    }
+
+    constexpr void insert_element(std::size_t position, const TElement& element)
+    {
+        for (auto index = element_count; index > position; index--)
+            elements[index] = std::move(elements[index - 1]);
+        elements[position] = element;
+        element_count++;
+    }
+
+    constexpr TElement erase_element(std::size_t position)
+    {
+        TElement element = std::move(elements[position]);
+        for (auto index = position + 1; index < element_count; index++)
+            elements[index - 1] = std::move(elements[index]);
+        elements[--element_count] = TElement();
+        return element;
+    }
+
+    // Undoes or redoes a step: an add becomes a remove keeping the element, and the other way round.
+    constexpr undo_step& toggle(std::size_t index)
+    {
+        auto& step = steps[index];
+        switch (step.operation) {
+            case operation_type::add:
+                step.element   = erase_element(step.position);
+                step.operation = operation_type::remove;
+                break;
+            case operation_type::remove:
+                insert_element(step.position, step.element);
+                step.element   = TElement();
+                step.operation = operation_type::add;
+                break;
+            case operation_type::update:
+                std::swap(elements[step.position], step.element);
+                break;
+        }
+        return step;
+    }
+
+    constexpr void record(operation_type operation, std::size_t position, TElement element)
+    {
+        while (step_count > undo_steps_count)
+            steps[index_of(--step_count)].element = TElement();
+
+        if (step_count == HistoryCapacity)
+            drop_oldest();
+        if (transaction_depth > 0 && transaction_first < dropped_count)
+            return;
+
+        auto joined = transaction_depth > 0 && dropped_count + step_count > transaction_first;
+        steps[index_of(step_count)] = undo_step{ operation, position, std::move(element), joined };
+        undo_steps_count = ++step_count;
+    }
+
+    // Overwrites the oldest operation. If that is the open transaction, it is given up.
+    constexpr void drop_oldest()
+    {
+        do {
+            steps[first_step].element = TElement();
+            first_step                = (first_step + 1) % HistoryCapacity;
+            dropped_count++;
+            step_count--;
+        } while (step_count > 0 && steps[first_step].joined);
+        undo_steps_count = step_count;
+    }
+};
+
+} // namespace shos
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "undo_redo_vector.h"
+#include "undo_redo_index_iterator.h"
+
+namespace shos {
+
+// Sequence with a gap at the last edit position. Edits next to the gap only move the gap boundary,
+// so a run of inserts and erases around a cursor, and their undo and redo, are amortized O(1).
+template <typename TElement>
+class gap_buffer
+{
+    std::vector<TElement> buffer;
+    std::size_t           gap_begin;
+    std::size_t           gap_end;
+
+public:
+    using value_type     = TElement;
+    using iterator       = index_iterator<gap_buffer, TElement>;
+    using const_iterator = index_iterator<const gap_buffer, const TElement>;
+
+    gap_buffer() : gap_begin(0), gap_end(0)
+    {}
+
+    std::size_t size() const
+    {
+        return buffer.size() - gap_size();
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    TElement& operator[](std::size_t index)
+    {
+        return buffer[index < gap_begin ? index : index + gap_size()];
+    }
+
+    const TElement& operator[](std::size_t index) const
+    {
+        return buffer[index < gap_begin ? index : index + gap_size()];
+    }
+
+    iterator begin()
+    {
+        return iterator(this, 0);
+    }
+
+    iterator end()
+    {
+        return iterator(this, size());
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(this, size());
+    }
+
+    const_iterator cbegin() const
+    {
+        return begin();
+    }
+
+    const_iterator cend() const
+    {
+        return end();
+    }
+
+    void push_back(const TElement& element)
+    {
+        insert(end(), element);
+    }
+
+    iterator insert(const_iterator before, const TElement& element)
+    {
+        auto index = before.get_index();
+        move_gap(index);
+        if (gap_size() == 0)
+            grow();
+        buffer[gap_begin++] = element;
+        return iterator(this, index);
+    }
+
+    iterator erase(const_iterator position)
+    {
+        auto index = position.get_index();
+        move_gap(index);
+        buffer[gap_end++] = TElement();
+        return iterator(this, index);
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        auto index = first.get_index();
+        auto count = last.get_index() - index;
+        move_gap(index);
+        std::fill(buffer.begin() + gap_end, buffer.begin() + gap_end + count, TElement());
+        gap_end += count;
+        return iterator(this, index);
+    }
+
+    // Appends default constructed elements or erases the tail, like std::vector::resize.
+    void resize(std::size_t new_size)
+    {
+        auto old_size = size();
+        if (new_size <= old_size) {
+            erase(begin() + new_size, end());
+            return;
+        }
+
+        move_gap(old_size);
+        while (gap_size() < new_size - old_size)
+            grow();
+        std::fill(buffer.begin() + gap_begin, buffer.begin() + gap_begin + (new_size - old_size), TElement());
+        gap_begin += new_size - old_size;
+    }
+
+    void clear()
+    {
+        buffer.clear();
+        gap_begin = gap_end = 0;
+    }
+
+private:
+    std::size_t gap_size() const
+    {
+        return gap_end - gap_begin;
+    }
+
+    void move_gap(std::size_t index)
+    {
+        if (index < gap_begin) {
+            std::move_backward(buffer.begin() + index, buffer.begin() + gap_begin, buffer.begin() + gap_end);
+            gap_end  -= gap_begin - index;
+            gap_begin = index;
+        } else if (index > gap_begin) {
+            auto count = index - gap_begin;
+            std::move(buffer.begin() + gap_end, buffer.begin() + gap_end + count, buffer.begin() + gap_begin);
+            gap_begin += count;
+            gap_end   += count;
+        }
+    }
+
+    void grow()
+    {
+        auto tail_size = buffer.size() - gap_end;
+        auto capacity  = std::max<std::size_t>(16, buffer.size() * 2);
+        buffer.resize(capacity);
+        std::move_backward(buffer.begin() + gap_end, buffer.begin() + gap_end + tail_size, buffer.end());
+        gap_end = capacity - tail_size;
+    }
+};
+
+template <typename TElement>
+using undo_redo_gap_buffer = undo_redo_collection<TElement, gap_buffer<TElement>>;
+
+} // namespace shos
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <limits>
+#include "undo_redo_vector.h"
+
+namespace shos {
+
+struct grid_rectangle
+{
+    double left;
+    double top;
+    double right;
+    double bottom;
+
+    bool contains(double x, double y) const
+    {
+        return left <= x && x <= right && top <= y && y <= bottom;
+    }
+
+    bool intersects(const grid_rectangle& rectangle) const
+    {
+        return left <= rectangle.right && rectangle.left <= right && top <= rectangle.bottom && rectangle.top <= bottom;
+    }
+};
+
+// Uniform grid over the bounds of the elements of an undo_redo_collection.
+// It observes the collection, so every operation, undo and redo keeps it up to date.
+// An element covering more than max_cells_per_element cells is kept in a list of its own that every query scans,
+// so that adding or removing a huge or unbounded element does not visit all its cells.
+template <typename TElement, typename TCollection = std::vector<TElement>>
+class undo_redo_grid_index : public undo_redo_collection<TElement, TCollection>::observer
+{
+    using collection_type = undo_redo_collection<TElement, TCollection>;
+    using position_type   = typename collection_type::position_type;
+    using cell_key        = std::uint64_t;
+
+    collection_type&                                     collection;
+    const double                                         cell_size;
+    const std::function<grid_rectangle(const TElement&)> bounds;
+    std::unordered_map<cell_key, std::vector<TElement>>  cells;
+    std::vector<TElement>                                oversized;
+
+public:
+    static constexpr double max_cells_per_element = 64.0;
+
+    undo_redo_grid_index(collection_type& collection, double cell_size, std::function<grid_rectangle(const TElement&)> bounds)
+        : collection(collection), cell_size(cell_size), bounds(bounds)
+    {
+        if (cell_size <= 0.0)
+            throw std::invalid_argument("cell_size must be positive");
+
+        rebuild();
+        collection.add_observer(*this);
+    }
+
+    virtual ~undo_redo_grid_index()
+    {
+        collection.remove_observer(*this);
+    }
+
+    undo_redo_grid_index(const undo_redo_grid_index&)            = delete;
+    undo_redo_grid_index& operator=(const undo_redo_grid_index&) = delete;
+
+    std::vector<TElement> query(double x, double y) const
+    {
+        std::vector<TElement> result;
+        for (const auto& element : oversized) {
+            if (bounds(element).contains(x, y))
+                result.push_back(element);
+        }
+
+        auto found = cells.find(key(cell_of(x), cell_of(y)));
+        if (found == cells.end())
+            return result;
+
+        for (const auto& element : found->second) {
+            if (bounds(element).contains(x, y))
+                result.push_back(element);
+        }
+        return result;
+    }
+
+    // Visits the cells in the area, or the occupied cells if there are fewer of them.
+    std::vector<TElement> query(const grid_rectangle& area) const
+    {
+        std::vector<TElement> result;
+        for (const auto& element : oversized) {
+            if (bounds(element).intersects(area))
+                result.push_back(element);
+        }
+
+        auto left   = cell_of(area.left  );
+        auto top    = cell_of(area.top   );
+        auto right  = cell_of(area.right );
+        auto bottom = cell_of(area.bottom);
+        if (right < left || bottom < top)
+            return result;
+
+        if (static_cast<double>(right - left + 1) * static_cast<double>(bottom - top + 1) > static_cast<double>(cells.size())) {
+            for (const auto& [cell_key, cell] : cells) {
+                auto x = x_of(cell_key);
+                auto y = y_of(cell_key);
+                if (left <= x && x <= right && top <= y && y <= bottom)
+                    collect(cell, x, y, area, result);
+            }
+        } else {
+            for (auto y = top; y <= bottom; y++) {
+                for (auto x = left; x <= right; x++) {
+                    auto found = cells.find(key(x, y));
+                    if (found != cells.end())
+                        collect(found->second, x, y, area, result);
+                }
+            }
+        }
+        return result;
+    }
+
+    virtual void on_insert(position_type, const TElement& element) override
+    {
+        add(element);
+    }
+
+    virtual void on_erase(position_type, const TElement& element) override
+    {
+        remove(element);
+    }
+
+    virtual void on_update(position_type, const TElement& old_element, const TElement& new_element) override
+    {
+        remove(old_element);
+        add(new_element);
+    }
+
+    virtual void on_reset() override
+    {
+        rebuild();
+    }
+
+private:
+    // Cells are numbered by 32-bit integers: coordinates beyond them fall into the outermost cells.
+    // The result is 64 bits wide, so that loops up to the last cell do not overflow.
+    std::int64_t cell_of(double coordinate) const
+    {
+        constexpr auto minimum = static_cast<double>(std::numeric_limits<std::int32_t>::min());
+        constexpr auto maximum = static_cast<double>(std::numeric_limits<std::int32_t>::max());
+
+        auto cell = std::floor(coordinate / cell_size);
+        if (!(cell > minimum))
+            return std::numeric_limits<std::int32_t>::min();
+        if (cell >= maximum)
+            return std::numeric_limits<std::int32_t>::max();
+        return static_cast<std::int64_t>(cell);
+    }
+
+    static cell_key key(std::int64_t x, std::int64_t y)
+    {
+        return (static_cast<cell_key>(static_cast<std::uint32_t>(x)) << 32) | static_cast<std::uint32_t>(y);
+    }
+
+    static std::int64_t x_of(cell_key key)
+    {
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(key >> 32));
+    }
+
+    static std::int64_t y_of(cell_key key)
+    {
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(key));
+    }
+
+    // An element spanning several cells is reported only by the cell holding the top left corner of the overlap.
+    void collect(const std::vector<TElement>& cell, std::int64_t x, std::int64_t y, const grid_rectangle& area, std::vector<TElement>& result) const
+    {
+        for (const auto& element : cell) {
+            auto element_bounds = bounds(element);
+            if (element_bounds.intersects(area) &&
+                cell_of(std::max(element_bounds.left, area.left)) == x &&
+                cell_of(std::max(element_bounds.top , area.top )) == y)
+                result.push_back(element);
+        }
+    }
+
+    bool is_oversized(const TElement& element) const
+    {
+        auto element_bounds = bounds(element);
+        auto width          = cell_of(element_bounds.right ) - cell_of(element_bounds.left) + 1;
+        auto height         = cell_of(element_bounds.bottom) - cell_of(element_bounds.top ) + 1;
+        return width > 0 && height > 0 && static_cast<double>(width) * static_cast<double>(height) > max_cells_per_element;
+    }
+
+    template <typename TFunction>
+    void for_each_cell(const TElement& element, TFunction function)
+    {
+        auto element_bounds = bounds(element);
+        for (auto y = cell_of(element_bounds.top); y <= cell_of(element_bounds.bottom); y++) {
+            for (auto x = cell_of(element_bounds.left); x <= cell_of(element_bounds.right); x++)
+                function(key(x, y));
+        }
+    }
+
+    static void remove_from(std::vector<TElement>& elements, const TElement& element)
+    {
+        auto position = std::find(elements.begin(), elements.end(), element);
+        if (position != elements.end()) {
+            *position = elements.back();
+            elements.pop_back();
+        }
+    }
+
+    void add(const TElement& element)
+    {
+        if (is_oversized(element))
+            oversized.push_back(element);
+        else
+            for_each_cell(element, [&](cell_key key) { cells[key].push_back(element); });
+    }
+
+    void remove(const TElement& element)
+    {
+        if (is_oversized(element)) {
+            remove_from(oversized, element);
+            return;
+        }
+
+        for_each_cell(element, [&](cell_key key) {
+            auto found = cells.find(key);
+            if (found == cells.end())
+                return;
+
+            auto& cell = found->second;
+            remove_from(cell, element);
+            if (cell.empty())
+                cells.erase(found);
+        });
+    }
+
+    void rebuild()
+    {
+        cells.clear();
+        oversized.clear();
+        std::for_each(collection.cbegin(), collection.cend(), [&](const TElement& element) { add(element); });
+    }
+};
+
+} // namespace shos
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include "undo_redo_vector.h"
+#include "undo_redo_order_tree.h"
+
+namespace shos {
+
+// Hash index from the key of each element to its position in an undo_redo_collection.
+// It observes the collection, so every operation, undo and redo keeps it up to date.
+// The keys map to entry ids that do not change when elements are shifted. The ids are kept in position order
+// in an order_tree, so an insertion or an erasure in the middle and the position of an id both take O(log n),
+// without hashing the shifted elements again.
+template <typename TElement, typename TKey = TElement, typename TCollection = std::vector<TElement>, typename THash = std::hash<TKey>>
+class undo_redo_hash_index : public undo_redo_collection<TElement, TCollection>::observer
+{
+    using collection_type = undo_redo_collection<TElement, TCollection>;
+
+    collection_type&                                  collection;
+    const std::function<TKey(const TElement&)>        key_of;
+    std::unordered_multimap<TKey, std::size_t, THash> entries;
+    order_tree<>                                      ids;
+
+public:
+    using iterator = typename collection_type::iterator;
+
+    undo_redo_hash_index(collection_type& collection, std::function<TKey(const TElement&)> key_of = [](const TElement& element) { return element; })
+        : collection(collection), key_of(key_of)
+    {
+        rebuild();
+        collection.add_observer(*this);
+    }
+
+    virtual ~undo_redo_hash_index()
+    {
+        collection.remove_observer(*this);
+    }
+
+    undo_redo_hash_index(const undo_redo_hash_index&)            = delete;
+    undo_redo_hash_index& operator=(const undo_redo_hash_index&) = delete;
+
+    iterator find(const TKey& key)
+    {
+        auto range = entries.equal_range(key);
+        if (range.first == range.second)
+            return collection.end();
+
+        auto position = std::numeric_limits<std::size_t>::max();
+        std::for_each(range.first, range.second, [&](const auto& entry) { position = std::min(position, ids.position_of(entry.second)); });
+        return std::next(collection.begin(), position);
+    }
+
+    bool contains(const TKey& key) const
+    {
+        return entries.find(key) != entries.end();
+    }
+
+    std::size_t count(const TKey& key) const
+    {
+        return entries.count(key);
+    }
+
+    bool erase_value(const TKey& key)
+    {
+        auto iterator = find(key);
+        if (iterator == collection.end())
+            return false;
+
+        collection.erase(iterator);
+        return true;
+    }
+
+    virtual void on_insert(std::size_t index, const TElement& element) override
+    {
+        entries.emplace(key_of(element), ids.insert(index));
+    }
+
+    virtual void on_erase(std::size_t index, const TElement& element) override
+    {
+        erase_entry(key_of(element), ids.erase(index));
+    }
+
+    virtual void on_update(std::size_t index, const TElement& old_element, const TElement& new_element) override
+    {
+        auto id = ids.id_at(index);
+        erase_entry(key_of(old_element), id);
+        entries.emplace(key_of(new_element), id);
+    }
+
+    virtual void on_reset() override
+    {
+        rebuild();
+    }
+
+private:
+    void erase_entry(const TKey& key, std::size_t id)
+    {
+        auto range = entries.equal_range(key);
+        auto entry = std::find_if(range.first, range.second, [&](const auto& entry) { return entry.second == id; });
+        if (entry != range.second)
+            entries.erase(entry);
+    }
+
+    void rebuild()
+    {
+        entries.clear();
+        ids.clear();
+        for (std::size_t position = 0; position < collection.size(); position++)
+            entries.emplace(key_of(collection[position]), ids.push_back());
+    }
+};
+
+} // namespace shos
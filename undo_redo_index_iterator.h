@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+namespace shos {
+
+// Random access iterator of a sequence that is addressed by index: it holds the sequence and an index into it.
+template <typename TSequence, typename TValue>
+class index_iterator
+{
+    TSequence*  sequence;
+    std::size_t index;
+
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type        = std::remove_const_t<TValue>;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = TValue*;
+    using reference         = TValue&;
+
+    index_iterator() : sequence(nullptr), index(0)
+    {}
+
+    index_iterator(TSequence* sequence, std::size_t index) : sequence(sequence), index(index)
+    {}
+
+    template <typename TOtherSequence, typename TOtherValue>
+    index_iterator(const index_iterator<TOtherSequence, TOtherValue>& other) : sequence(other.get_sequence()), index(other.get_index())
+    {}
+
+    TSequence* get_sequence() const
+    {
+        return sequence;
+    }
+
+    std::size_t get_index() const
+    {
+        return index;
+    }
+
+    reference operator*() const
+    {
+        return (*sequence)[index];
+    }
+
+    pointer operator->() const
+    {
+        return &(*sequence)[index];
+    }
+
+    reference operator[](difference_type offset) const
+    {
+        return (*sequence)[index + offset];
+    }
+
+    index_iterator& operator++()
+    {
+        index++;
+        return *this;
+    }
+
+    index_iterator operator++(int)
+    {
+        auto copy = *this;
+        index++;
+        return copy;
+    }
+
+    index_iterator& operator--()
+    {
+        index--;
+        return *this;
+    }
+
+    index_iterator operator--(int)
+    {
+        auto copy = *this;
+        index--;
+        return copy;
+    }
+
+    index_iterator& operator+=(difference_type offset)
+    {
+        index += offset;
+        return *this;
+    }
+
+    index_iterator& operator-=(difference_type offset)
+    {
+        index -= offset;
+        return *this;
+    }
+
+    index_iterator operator+(difference_type offset) const
+    {
+        return index_iterator(sequence, index + offset);
+    }
+
+    friend index_iterator operator+(difference_type offset, const index_iterator& iterator)
+    {
+        return iterator + offset;
+    }
+
+    index_iterator operator-(difference_type offset) const
+    {
+        return index_iterator(sequence, index - offset);
+    }
+
+    difference_type operator-(const index_iterator& other) const
+    {
+        return static_cast<difference_type>(index) - static_cast<difference_type>(other.index);
+    }
+
+    bool operator==(const index_iterator& other) const
+    {
+        return index == other.index;
+    }
+
+    bool operator!=(const index_iterator& other) const
+    {
+        return index != other.index;
+    }
+
+    bool operator<(const index_iterator& other) const
+    {
+        return index < other.index;
+    }
+
+    bool operator>(const index_iterator& other) const
+    {
+        return index > other.index;
+    }
+
+    bool operator<=(const index_iterator& other) const
+    {
+        return index <= other.index;
+    }
+
+    bool operator>=(const index_iterator& other) const
+    {
+        return index >= other.index;
+    }
+};
+
+} // namespace shos
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+namespace shos {
+
+// Shared history of several undo_redo_collections, whatever their element types.
+// Each collection keeps its own steps; the manager records which collections one action touched,
+// so that one undo() or redo() on the manager or on any of them reverts or repeats the whole action.
+class undo_redo_manager
+{
+public:
+    class participant
+    {
+        friend class undo_redo_manager;
+
+        undo_redo_manager* manager;
+
+    public:
+        participant() : manager(nullptr)
+        {}
+
+        virtual ~participant()
+        {
+            if (manager != nullptr)
+                manager->detach(*this);
+        }
+
+        participant(const participant&)            = delete;
+        participant& operator=(const participant&) = delete;
+
+    protected:
+        undo_redo_manager* get_manager() const
+        {
+            return manager;
+        }
+
+        // Reports that a step has been pushed to the history of this participant.
+        void record()
+        {
+            if (manager != nullptr)
+                manager->record(*this);
+        }
+
+        // Reports that the history of this participant has been discarded.
+        void forget()
+        {
+            if (manager != nullptr)
+                manager->forget(*this);
+        }
+
+    private:
+        virtual std::size_t begin_transaction () = 0;
+        virtual void        end_transaction   () = 0;
+        virtual void        rollback_to       (std::size_t savepoint) = 0;
+        virtual bool        undo_last_step    () = 0;
+        virtual bool        redo_next_step    () = 0;
+        virtual void        discard_redo_steps() = 0;
+    };
+
+private:
+    std::vector<participant*> participants;
+    std::vector<participant*> entry_participants;
+    std::vector<std::size_t>  entry_ends;
+    std::size_t               entries_index;
+    std::vector<participant*> pending;
+    std::vector<std::size_t>  savepoints;
+    std::size_t               transaction_depth;
+
+public:
+    undo_redo_manager() : entries_index(0), transaction_depth(0)
+    {}
+
+    virtual ~undo_redo_manager()
+    {
+        std::for_each(participants.begin(), participants.end(), [](participant* participant) { participant->manager = nullptr; });
+    }
+
+    undo_redo_manager(const undo_redo_manager&)            = delete;
+    undo_redo_manager& operator=(const undo_redo_manager&) = delete;
+
+    // Steps a collection recorded before it was added stay in its history but are no longer reached by undo().
+    void add(participant& participant)
+    {
+        if (participant.manager != nullptr || transaction_depth > 0)
+            throw std::logic_error("an exception occurred");
+
+        participant.manager = this;
+        participants.push_back(&participant);
+    }
+
+    void remove(participant& participant)
+    {
+        if (participant.manager != this || transaction_depth > 0)
+            throw std::logic_error("an exception occurred");
+
+        detach(participant);
+    }
+
+    bool undo()
+    {
+        if (entries_index == 0 || transaction_depth > 0)
+            return false;
+
+        auto first = entries_index == 1 ? 0 : entry_ends[entries_index - 2];
+        for (auto index = entry_ends[entries_index - 1]; index > first; index--)
+            entry_participants[index - 1]->undo_last_step();
+        entries_index--;
+        return true;
+    }
+
+    bool redo()
+    {
+        if (entries_index == entry_ends.size() || transaction_depth > 0)
+            return false;
+
+        auto first = entries_index == 0 ? 0 : entry_ends[entries_index - 1];
+        for (auto index = first; index < entry_ends[entries_index]; index++)
+            entry_participants[index]->redo_next_step();
+        entries_index++;
+        return true;
+    }
+
+    bool can_undo() const
+    {
+        return entries_index != 0;
+    }
+
+    bool can_redo() const
+    {
+        return entries_index != entry_ends.size();
+    }
+
+    // Opens a transaction on every participant. Whatever they record until it ends is undone and redone as one action,
+    // and a transaction left by an exception rolls all of them back.
+    class transaction
+    {
+        undo_redo_manager& manager;
+        const int          uncaught_exceptions;
+
+    public:
+        transaction(undo_redo_manager& manager) : manager(manager), uncaught_exceptions(std::uncaught_exceptions())
+        {
+            manager.begin_transaction();
+        }
+
+        virtual ~transaction()
+        {
+            manager.end_transaction(std::uncaught_exceptions() > uncaught_exceptions);
+        }
+    };
+
+private:
+    void begin_transaction()
+    {
+        if (transaction_depth++ > 0)
+            return;
+
+        savepoints.clear();
+        std::for_each(participants.begin(), participants.end(), [&](participant* participant) { savepoints.push_back(participant->begin_transaction()); });
+    }
+
+    void end_transaction(bool rollback)
+    {
+        if (transaction_depth == 0)
+            throw std::logic_error("an exception occurred");
+        if (transaction_depth > 1) {
+            transaction_depth--;
+            return;
+        }
+
+        for (std::size_t index = 0; index < participants.size(); index++) {
+            if (rollback)
+                participants[index]->rollback_to(savepoints[index]);
+            participants[index]->end_transaction();
+        }
+        transaction_depth = 0;
+
+        if (!pending.empty())
+            push(pending);
+        pending.clear();
+    }
+
+    void record(participant& participant)
+    {
+        if (transaction_depth > 0)
+            pending.push_back(&participant);
+        else
+            push({ &participant });
+    }
+
+    void push(const std::vector<participant*>& entry)
+    {
+        if (entries_index != entry_ends.size()) {
+            entry_participants.resize(entries_index == 0 ? 0 : entry_ends[entries_index - 1]);
+            entry_ends.resize(entries_index);
+            std::for_each(participants.begin(), participants.end(), [](participant* participant) { participant->discard_redo_steps(); });
+        }
+
+        entry_participants.insert(entry_participants.end(), entry.begin(), entry.end());
+        entry_ends.push_back(entry_participants.size());
+        entries_index++;
+    }
+
+    void detach(participant& participant)
+    {
+        forget(participant);
+        auto found = std::find(participants.begin(), participants.end(), &participant);
+        if (transaction_depth > 0)
+            savepoints.erase(savepoints.begin() + std::distance(participants.begin(), found));
+        participants.erase(found);
+        participant.manager = nullptr;
+    }
+
+    // Drops the participant from every entry. Entries left empty are dropped as well.
+    void forget(participant& participant)
+    {
+        std::vector<undo_redo_manager::participant*> kept;
+        std::vector<std::size_t>                     ends;
+        std::size_t                                  index = 0;
+        std::size_t                                  first = 0;
+        for (std::size_t entry = 0; entry < entry_ends.size(); entry++) {
+            std::copy_if(entry_participants.begin() + first, entry_participants.begin() + entry_ends[entry], std::back_inserter(kept),
+                         [&](auto other) { return other != &participant; });
+            if (kept.size() > (ends.empty() ? 0 : ends.back())) {
+                ends.push_back(kept.size());
+                if (entry < entries_index)
+                    index++;
+            }
+            first = entry_ends[entry];
+        }
+        entry_participants.swap(kept);
+        entry_ends.swap(ends);
+        entries_index = index;
+        pending.erase(std::remove(pending.begin(), pending.end(), &participant), pending.end());
+    }
+};
+
+} // namespace shos
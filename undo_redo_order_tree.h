@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <random>
+#include <limits>
+#include <utility>
+
+namespace shos {
+
+// Aggregate of an order_tree that keeps nothing.
+struct no_aggregate
+{
+    static no_aggregate concat(const no_aggregate&, const no_aggregate&)
+    {
+        return {};
+    }
+};
+
+// Sequence of ids kept in position order in a randomized balanced tree (a treap) that knows the size of each subtree.
+// Inserting and erasing at a position, the id at a position and the position of an id all take O(log n),
+// and the id of an element does not change when elements before it are inserted or erased.
+// Each element holds a TAggregate, and each subtree the TAggregate::concat() of its elements in order, so that
+// the aggregate of the whole sequence is kept up to date in O(log n) as well. concat() has to be associative,
+// and a default constructed TAggregate stands for the empty sequence.
+template <typename TAggregate = no_aggregate>
+class order_tree
+{
+public:
+    static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+private:
+    struct node
+    {
+        std::size_t   left;
+        std::size_t   right;
+        std::size_t   parent;
+        std::size_t   size;
+        std::uint32_t priority;
+        TAggregate    value;
+        TAggregate    total;
+    };
+
+    std::vector<node>        nodes;
+    std::vector<std::size_t> free_ids;
+    std::size_t              root;
+    std::minstd_rand         random;
+
+public:
+    order_tree() : root(none)
+    {}
+
+    std::size_t size() const
+    {
+        return size_of(root);
+    }
+
+    TAggregate total() const
+    {
+        return root == none ? TAggregate() : nodes[root].total;
+    }
+
+    // Returns the id of the new element.
+    std::size_t insert(std::size_t position, const TAggregate& value = TAggregate())
+    {
+        auto id            = new_id(value);
+        auto [left, right] = split(root, position);
+        set_root(merge(merge(left, id), right));
+        return id;
+    }
+
+    std::size_t push_back(const TAggregate& value = TAggregate())
+    {
+        auto id = new_id(value);
+        set_root(merge(root, id));
+        return id;
+    }
+
+    // Returns the id of the erased element. The next insertion may reuse it.
+    std::size_t erase(std::size_t position)
+    {
+        auto [left, rest] = split(root, position);
+        auto [id, right]  = split(rest, 1);
+        set_root(merge(left, right));
+        free_ids.push_back(id);
+        return id;
+    }
+
+    void assign(std::size_t id, const TAggregate& value)
+    {
+        nodes[id].value = value;
+        for (; id != none; id = nodes[id].parent)
+            update(id);
+    }
+
+    std::size_t position_of(std::size_t id) const
+    {
+        auto position = size_of(nodes[id].left);
+        for (auto parent = nodes[id].parent; parent != none; id = parent, parent = nodes[id].parent) {
+            if (nodes[parent].right == id)
+                position += size_of(nodes[parent].left) + 1;
+        }
+        return position;
+    }
+
+    std::size_t id_at(std::size_t position) const
+    {
+        auto id = root;
+        for (;;) {
+            auto left_size = size_of(nodes[id].left);
+            if (position == left_size)
+                return id;
+            if (position < left_size) {
+                id = nodes[id].left;
+            } else {
+                position -= left_size + 1;
+                id        = nodes[id].right;
+            }
+        }
+    }
+
+    void clear()
+    {
+        nodes.clear();
+        free_ids.clear();
+        root = none;
+    }
+
+private:
+    std::size_t size_of(std::size_t id) const
+    {
+        return id == none ? 0 : nodes[id].size;
+    }
+
+    std::size_t new_id(const TAggregate& value)
+    {
+        auto id = nodes.size();
+        if (free_ids.empty()) {
+            nodes.push_back(node());
+        } else {
+            id = free_ids.back();
+            free_ids.pop_back();
+        }
+        nodes[id] = node{ none, none, none, 1, static_cast<std::uint32_t>(random()), value, value };
+        return id;
+    }
+
+    void set_root(std::size_t id)
+    {
+        root = id;
+        if (root != none)
+            nodes[root].parent = none;
+    }
+
+    // Recomputes the size and the aggregate of a node whose children have changed, and links them back to it.
+    void update(std::size_t id)
+    {
+        auto& current = nodes[id];
+        current.size  = 1 + size_of(current.left) + size_of(current.right);
+        current.total = current.value;
+        if (current.left != none) {
+            nodes[current.left].parent = id;
+            current.total              = TAggregate::concat(nodes[current.left].total, current.total);
+        }
+        if (current.right != none) {
+            nodes[current.right].parent = id;
+            current.total               = TAggregate::concat(current.total, nodes[current.right].total);
+        }
+    }
+
+    std::size_t merge(std::size_t left, std::size_t right)
+    {
+        if (left == none)
+            return right;
+        if (right == none)
+            return left;
+        if (nodes[left].priority > nodes[right].priority) {
+            nodes[left].right = merge(nodes[left].right, right);
+            update(left);
+            return left;
+        }
+        nodes[right].left = merge(left, nodes[right].left);
+        update(right);
+        return right;
+    }
+
+    // Splits the tree into its first count ids and the rest.
+    std::pair<std::size_t, std::size_t> split(std::size_t id, std::size_t count)
+    {
+        if (id == none)
+            return { none, none };
+
+        auto left_size = size_of(nodes[id].left);
+        if (count <= left_size) {
+            auto [left, right] = split(nodes[id].left, count);
+            nodes[id].left     = right;
+            update(id);
+            return { left, id };
+        }
+        auto [left, right] = split(nodes[id].right, count - left_size - 1);
+        nodes[id].right    = left;
+        update(id);
+        return { id, right };
+    }
+};
+
+} // namespace shos
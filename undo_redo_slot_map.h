@@ -0,0 +1,305 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <stdexcept>
+#include "undo_redo_vector.h"
+
+namespace shos {
+
+// Dense array of elements addressed through generational handles.
+// Erasing moves the last element into the hole, so erase and restore never shift the other elements,
+// and a handle stays valid until its slot is released.
+template <typename TElement>
+class slot_map
+{
+public:
+    struct handle
+    {
+        std::uint32_t index;
+        std::uint32_t generation;
+
+        bool operator==(const handle& other) const
+        {
+            return index == other.index && generation == other.generation;
+        }
+
+        bool operator!=(const handle& other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    using value_type     = TElement;
+    using iterator       = typename std::vector<TElement>::iterator;
+    using const_iterator = typename std::vector<TElement>::const_iterator;
+
+private:
+    enum class slot_state : std::uint8_t
+    {
+        free    ,
+        occupied,
+        detached
+    };
+
+    struct slot
+    {
+        std::uint32_t generation;
+        std::uint32_t dense_index;
+        slot_state    state;
+    };
+
+    std::vector<TElement>      elements;
+    std::vector<std::uint32_t> dense_to_slot;
+    std::vector<slot>          slots;
+    std::vector<std::uint32_t> free_slots;
+
+public:
+    std::size_t size() const
+    {
+        return elements.size();
+    }
+
+    bool empty() const
+    {
+        return elements.empty();
+    }
+
+    iterator begin()
+    {
+        return elements.begin();
+    }
+
+    iterator end()
+    {
+        return elements.end();
+    }
+
+    const_iterator begin() const
+    {
+        return elements.begin();
+    }
+
+    const_iterator end() const
+    {
+        return elements.end();
+    }
+
+    const_iterator cbegin() const
+    {
+        return elements.cbegin();
+    }
+
+    const_iterator cend() const
+    {
+        return elements.cend();
+    }
+
+    TElement& operator[](std::size_t dense_index)
+    {
+        return elements[dense_index];
+    }
+
+    const TElement& operator[](std::size_t dense_index) const
+    {
+        return elements[dense_index];
+    }
+
+    // Throws std::out_of_range for a handle whose element has been erased, so that a stale handle never reaches the element now in its slot.
+    TElement& operator[](handle handle)
+    {
+        check(handle, slot_state::occupied);
+        return elements[slots[handle.index].dense_index];
+    }
+
+    const TElement& operator[](handle handle) const
+    {
+        check(handle, slot_state::occupied);
+        return elements[slots[handle.index].dense_index];
+    }
+
+    bool contains(handle handle) const
+    {
+        return handle.index < slots.size() && slots[handle.index].generation == handle.generation && slots[handle.index].state == slot_state::occupied;
+    }
+
+    handle handle_of(std::size_t dense_index) const
+    {
+        auto index = dense_to_slot[dense_index];
+        return { index, slots[index].generation };
+    }
+
+    handle insert(const TElement& element)
+    {
+        std::uint32_t index;
+        if (free_slots.empty()) {
+            index = static_cast<std::uint32_t>(slots.size());
+            slots.push_back({ 0, 0, slot_state::free });
+        } else {
+            index = free_slots.back();
+            free_slots.pop_back();
+        }
+        attach(index, element);
+        return { index, slots[index].generation };
+    }
+
+    // Takes the element out but keeps its slot, so that restore() can bring it back under the same handle.
+    TElement detach(handle handle)
+    {
+        check(handle, slot_state::occupied);
+        auto& slot        = slots[handle.index];
+        auto  dense_index = slot.dense_index;
+        auto  element     = std::move(elements[dense_index]);
+
+        if (dense_index + 1 != elements.size()) {
+            elements[dense_index]                         = std::move(elements.back());
+            dense_to_slot[dense_index]                    = dense_to_slot.back();
+            slots[dense_to_slot[dense_index]].dense_index = dense_index;
+        }
+        elements.pop_back();
+        dense_to_slot.pop_back();
+        slot.state = slot_state::detached;
+        return element;
+    }
+
+    void restore(handle handle, const TElement& element)
+    {
+        check(handle, slot_state::detached);
+        attach(handle.index, element);
+    }
+
+    // Frees a detached slot for reuse. Its handle is invalidated.
+    void release(handle handle)
+    {
+        check(handle, slot_state::detached);
+        vacate(handle.index);
+    }
+
+    void erase(handle handle)
+    {
+        detach(handle);
+        release(handle);
+    }
+
+    void clear()
+    {
+        for (auto index : dense_to_slot)
+            vacate(index);
+        elements.clear();
+        dense_to_slot.clear();
+    }
+
+private:
+    void check(handle handle, slot_state state) const
+    {
+        if (handle.index >= slots.size() || slots[handle.index].generation != handle.generation || slots[handle.index].state != state)
+            throw std::out_of_range("invalid handle");
+    }
+
+    void attach(std::uint32_t index, const TElement& element)
+    {
+        slots[index].dense_index = static_cast<std::uint32_t>(elements.size());
+        slots[index].state       = slot_state::occupied;
+        elements.push_back(element);
+        dense_to_slot.push_back(index);
+    }
+
+    void vacate(std::uint32_t index)
+    {
+        slots[index].generation++;
+        slots[index].state = slot_state::free;
+        free_slots.push_back(index);
+    }
+};
+
+// Positions in a slot_map are handles, so undo steps do not depend on where an element sits in the dense array.
+template <typename TElement>
+class collection_adapter<slot_map<TElement>>
+{
+public:
+    using element_type = TElement;
+    using iterator     = typename slot_map<TElement>::iterator;
+    using position     = typename slot_map<TElement>::handle;
+
+    position position_of(slot_map<TElement>& collection, iterator iterator) const
+    {
+        return collection.handle_of(std::distance(collection.begin(), iterator));
+    }
+
+    element_type& at(slot_map<TElement>& collection, position position) const
+    {
+        return collection[position];
+    }
+
+    position append(slot_map<TElement>& collection, const element_type& element)
+    {
+        return collection.insert(element);
+    }
+
+    element_type erase(slot_map<TElement>& collection, position& position)
+    {
+        return collection.detach(position);
+    }
+
+    void restore(slot_map<TElement>& collection, position& position, const element_type& element)
+    {
+        collection.restore(position, element);
+    }
+
+    void release(slot_map<TElement>& collection, position position)
+    {
+        collection.release(position);
+    }
+
+    void clear(slot_map<TElement>& collection)
+    {
+        collection.clear();
+    }
+};
+
+template <typename TElement>
+class undo_redo_slot_map : public undo_redo_collection<TElement, slot_map<TElement>>
+{
+    using base_type = undo_redo_collection<TElement, slot_map<TElement>>;
+
+public:
+    using handle = typename slot_map<TElement>::handle;
+
+    using base_type::base_type;
+    using base_type::operator[];
+    using base_type::erase;
+    using base_type::update;
+
+    handle insert(TElement element)
+    {
+        return this->append(element);
+    }
+
+    const TElement& operator[](handle handle) const
+    {
+        return this->get_collection()[handle];
+    }
+
+    bool contains(handle handle) const
+    {
+        return this->get_collection().contains(handle);
+    }
+
+    handle handle_of(typename base_type::const_iterator iterator) const
+    {
+        return this->get_collection().handle_of(std::distance(this->cbegin(), iterator));
+    }
+
+    void erase(handle handle)
+    {
+        this->erase_at(handle);
+    }
+
+    void update(handle handle, TElement element)
+    {
+        this->update_at(handle, element);
+    }
+};
+
+} // namespace shos
@@ -1,375 +1,2147 @@
 #pragma once
 
+#include <cstdint>
 #include <iterator>
 #include <vector>
+#include <memory>
+#include <memory_resource>
 #include <list>
 #include <algorithm>
+#include <numeric>
 #include <stdexcept>
+#include <exception>
 #include <functional>
+#include <type_traits>
+#include <limits>
+#include <chrono>
+#include <span>
+#include <cstddef>
+#include <atomic>
+#include "undo_redo_manager.h"
+
+// The parallel algorithms are opt-in. libstdc++ runs them on TBB, so a program that uses them has to link it;
+// define SHOS_UNDO_REDO_PARALLEL before including this header to turn them on.
+#if defined(SHOS_UNDO_REDO_PARALLEL)
+#include <execution>
+#endif
 
 namespace shos {
 
+// The standard parallel algorithms when they are turned on and the library has them, the serial ones otherwise.
+namespace parallel {
+
+#if defined(SHOS_UNDO_REDO_PARALLEL) && defined(__cpp_lib_parallel_algorithm)
+inline constexpr bool enabled = true;
+#define SHOS_UNDO_REDO_POLICY std::execution::par,
+#else
+inline constexpr bool enabled = false;
+#define SHOS_UNDO_REDO_POLICY
+#endif
+
+template <typename... TArguments>
+void for_each(TArguments&&... arguments)
+{
+    std::for_each(SHOS_UNDO_REDO_POLICY std::forward<TArguments>(arguments)...);
+}
+
+template <typename... TArguments>
+void transform(TArguments&&... arguments)
+{
+    std::transform(SHOS_UNDO_REDO_POLICY std::forward<TArguments>(arguments)...);
+}
+
+template <typename... TArguments>
+void swap_ranges(TArguments&&... arguments)
+{
+    std::swap_ranges(SHOS_UNDO_REDO_POLICY std::forward<TArguments>(arguments)...);
+}
+
+template <typename... TArguments>
+void sort(TArguments&&... arguments)
+{
+    std::sort(SHOS_UNDO_REDO_POLICY std::forward<TArguments>(arguments)...);
+}
+
+template <typename... TArguments>
+void stable_sort(TArguments&&... arguments)
+{
+    std::stable_sort(SHOS_UNDO_REDO_POLICY std::forward<TArguments>(arguments)...);
+}
+
+#undef SHOS_UNDO_REDO_POLICY
+
+} // namespace parallel
+
+// Maps the positions recorded by undo steps onto a collection.
+// An erased element keeps its position until release(), so that restore() can put it back there.
+// The primary template serves random access sequences, where a position is an index.
+template <typename TCollection>
+class collection_adapter
+{
+public:
+    using element_type = typename TCollection::value_type;
+    using iterator     = typename TCollection::iterator;
+    using position     = std::size_t;
+
+    position position_of(TCollection& collection, iterator iterator) const
+    {
+        return std::distance(collection.begin(), iterator);
+    }
+
+    element_type& at(TCollection& collection, position position) const
+    {
+        return collection[position];
+    }
+
+    position append(TCollection& collection, const element_type& element)
+    {
+        collection.push_back(element);
+        return collection.size() - 1;
+    }
+
+    position insert(TCollection& collection, iterator before, const element_type& element)
+    {
+        return std::distance(collection.begin(), collection.insert(before, element));
+    }
+
+    element_type erase(TCollection& collection, position& position)
+    {
+        auto element = collection[position];
+        collection.erase(std::next(collection.begin(), position));
+        return element;
+    }
+
+    void restore(TCollection& collection, position& position, const element_type& element)
+    {
+        collection.insert(std::next(collection.begin(), position), element);
+    }
+
+    void release(TCollection&, position)
+    {}
+
+    void clear(TCollection& collection)
+    {
+        collection.clear();
+    }
+
+    // Called before the elements in [first, last) are accessed from several threads at once. A backend whose operator[]
+    // may write to itself, like the copy on write of chunked_vector, does that here by make_writable(first, last).
+    void prepare_concurrent_access(TCollection& collection, std::size_t first, std::size_t last)
+    {
+        if constexpr (requires { collection.make_writable(first, last); })
+            collection.make_writable(first, last);
+    }
+};
+
+// Positions in a std::list are its nodes. An erased node is spliced into a list of detached nodes
+// and spliced back on restore, so every iterator held by the history stays valid and no step walks the list.
+template <typename TElement, typename TAllocator>
+class collection_adapter<std::list<TElement, TAllocator>>
+{
+    using collection_type = std::list<TElement, TAllocator>;
+
+public:
+    using element_type = TElement;
+    using iterator     = typename collection_type::iterator;
+
+    struct position
+    {
+        iterator node;
+        iterator next;
+    };
+
+private:
+    collection_type detached;
+
+public:
+    position position_of(collection_type&, iterator iterator) const
+    {
+        return { iterator, std::next(iterator) };
+    }
+
+    element_type& at(collection_type&, position position) const
+    {
+        return *position.node;
+    }
+
+    position append(collection_type& collection, const element_type& element)
+    {
+        return insert(collection, collection.end(), element);
+    }
+
+    position insert(collection_type& collection, iterator before, const element_type& element)
+    {
+        auto node = collection.insert(before, element);
+        return { node, before };
+    }
+
+    element_type erase(collection_type& collection, position& position)
+    {
+        position.next = std::next(position.node);
+        auto element  = *position.node;
+        detached.splice(detached.end(), collection, position.node);
+        return element;
+    }
+
+    void restore(collection_type& collection, position& position, const element_type& element)
+    {
+        *position.node = element;
+        collection.splice(position.next, detached, position.node);
+    }
+
+    void release(collection_type&, position position)
+    {
+        detached.erase(position.node);
+    }
+
+    void clear(collection_type& collection)
+    {
+        collection.clear();
+    }
+};
+
 template <typename TElement, typename TCollection = std::vector<TElement>>
-class undo_redo_collection
+class undo_redo_collection : public undo_redo_manager::participant
 {
+    using adapter_type = collection_adapter<TCollection>;
+
+public:
+    using position_type = typename adapter_type::position;
+
+    // Receives every change made to the elements, whether by an operation, an undo or a redo.
+    class observer
+    {
+    public:
+        virtual ~observer()
+        {}
+
+        virtual void on_insert(position_type position, const TElement& element) = 0;
+        virtual void on_erase (position_type position, const TElement& element) = 0;
+        virtual void on_update(position_type position, const TElement& old_element, const TElement& new_element) = 0;
+        virtual void on_reset () = 0;
+
+        // Called once the changes reported so far have been recorded as one step,
+        // and after undo() or redo() has reverted or repeated one step.
+        virtual void on_commit()
+        {}
+
+        virtual void on_undo()
+        {}
+
+        virtual void on_redo()
+        {}
+    };
+
+private:
+    // Calls either a per-element function or a span function. While a batch is open, elements cleaned up one by one
+    // are gathered and passed to the span function batch_size at a time.
     class clean_up_function
     {
-        std::function<void(TElement)> clean_up;
+        static constexpr std::size_t batch_size = 1024;
+
+        std::function<void(TElement)>                  clean_up;
+        std::function<void(std::span<const TElement>)> clean_up_span;
+        mutable std::pmr::vector<TElement>             batch;
+        mutable std::size_t                            batch_depth;
 
     public:
-        clean_up_function(std::function<void(TElement)> clean_up) : clean_up(clean_up)
+        clean_up_function(std::function<void(TElement)> clean_up, std::pmr::memory_resource* resource)
+            : clean_up(clean_up), batch(resource), batch_depth(0)
+        {}
+
+        clean_up_function(std::function<void(std::span<const TElement>)> clean_up_span, std::pmr::memory_resource* resource)
+            : clean_up_span(clean_up_span), batch(resource), batch_depth(0)
         {}
 
         void operator()(TElement element) const
         {
-            clean_up(element);
+            if (clean_up) {
+                clean_up(element);
+            } else if (batch_depth == 0) {
+                clean_up_span(std::span<const TElement>(&element, 1));
+            } else {
+                batch.push_back(element);
+                if (batch.size() == batch_size)
+                    flush();
+            }
+        }
+
+        void operator()(std::span<const TElement> elements) const
+        {
+            if (clean_up)
+                std::for_each(elements.begin(), elements.end(), [&](TElement element) { clean_up(element); });
+            else if (!elements.empty())
+                clean_up_span(elements);
+        }
+
+        void begin_batch() const
+        {
+            batch_depth++;
+        }
+
+        void end_batch() const
+        {
+            if (--batch_depth == 0)
+                flush();
+        }
+
+    private:
+        void flush() const
+        {
+            if (batch.empty())
+                return;
+            clean_up_span(batch);
+            batch.clear();
         }
     };
 
+    // Gathers the clean-ups done in its scope into spans.
+    class clean_up_batch
+    {
+        const clean_up_function* const clean_up;
+
+    public:
+        clean_up_batch(const clean_up_function* clean_up) : clean_up(clean_up)
+        {
+            if (clean_up != nullptr)
+                clean_up->begin_batch();
+        }
+
+        ~clean_up_batch()
+        {
+            if (clean_up != nullptr)
+                clean_up->end_batch();
+        }
+
+        clean_up_batch(const clean_up_batch&)            = delete;
+        clean_up_batch& operator=(const clean_up_batch&) = delete;
+    };
+
     class undo_step
     {
+        struct alignas(std::max_align_t) allocation_header
+        {
+            std::pmr::memory_resource* resource;
+            std::size_t                size;
+        };
+
     public:
         enum class operation_type
         {
-            add   ,
-            remove,
-            update,
-            group
+            add    ,
+            remove ,
+            update ,
+            group  ,
+            reorder,
+            range  ,
+            append ,
+            compact
         };
 
     private:
-        TCollection&                   collection;
+        undo_redo_collection*          owner;
         operation_type                 operation;
-        std::size_t                    index;
+        position_type                  position;
         TElement                       element;
         bool                           hasElement;
         const clean_up_function* const clean_up;
+        std::size_t                    version;
+        std::atomic<std::size_t>       share_count;
 
     public:
+        // Steps are allocated from the memory resource of their collection, which is kept in front of each of them.
+        // They are made by create() and destroy() rather than by new and delete expressions, which a macro redefining new,
+        // like the one of MemoryLeakTest.h, would turn into syntax errors.
+        template <typename TStep, typename... TArguments>
+        static TStep* create(std::pmr::memory_resource* resource, TArguments&&... arguments)
+        {
+            constexpr auto size   = sizeof(allocation_header) + sizeof(TStep);
+            auto           header = static_cast<allocation_header*>(resource->allocate(size, alignof(allocation_header)));
+            *header               = { resource, sizeof(TStep) };
+            try {
+                return std::construct_at(reinterpret_cast<TStep*>(header + 1), std::forward<TArguments>(arguments)...);
+            } catch (...) {
+                resource->deallocate(header, size, alignof(allocation_header));
+                throw;
+            }
+        }
+
+        static void destroy(undo_step* step)
+        {
+            if (step == nullptr)
+                return;
+
+            auto header   = static_cast<allocation_header*>(dynamic_cast<void*>(step)) - 1;
+            auto resource = header->resource;
+            auto size     = sizeof(allocation_header) + header->size;
+            std::destroy_at(step);
+            resource->deallocate(header, size, alignof(allocation_header));
+        }
+
         operation_type get_operation_type()
         {
             return operation;
         }
 
+        std::size_t get_version() const
+        {
+            return version;
+        }
+
+        void set_version(std::size_t version)
+        {
+            this->version = version;
+        }
+
         TElement get_element() const
         {
             return element;
         }
 
+        position_type get_position() const
+        {
+            return position;
+        }
+
         virtual ~undo_step()
         {
+            if constexpr (!std::is_integral_v<position_type>) {
+                if (operation == operation_type::remove)
+                    owner->release_element(position);
+            }
             if (hasElement && clean_up != nullptr)
                 (*clean_up)(element);
         }
         
-        static undo_step* add(TCollection& collection, TElement element, const clean_up_function* clean_up = nullptr)
+        static undo_step* add(undo_redo_collection& owner, TElement element, const clean_up_function* clean_up = nullptr)
+        {
+            auto position = owner.append_element(element);
+            return undo_step::create<undo_step>(owner.resource, owner, operation_type::add, position, clean_up);
+        }
+
+        static undo_step* insert(undo_redo_collection& owner, typename TCollection::iterator before, TElement element, const clean_up_function* clean_up = nullptr)
+        {
+            auto position = owner.insert_element(before, element);
+            return undo_step::create<undo_step>(owner.resource, owner, operation_type::add, position, clean_up);
+        }
+
+        static undo_step* remove(undo_redo_collection& owner, position_type position, const clean_up_function* clean_up = nullptr)
+        {
+            auto element = owner.erase_element(position);
+            return undo_step::create<undo_step>(owner.resource, owner, operation_type::remove, position, std::move(element), clean_up);
+        }
+
+        static undo_step* update(undo_redo_collection& owner, position_type position, TElement element, const clean_up_function* clean_up = nullptr)
+        {
+            owner.exchange_element(position, element);
+            return undo_step::create<undo_step>(owner.resource, owner, operation_type::update, position, std::move(element), clean_up);
+        }
+
+        // The element at position has already been changed in place; element is the value it had before.
+        static undo_step* modify(undo_redo_collection& owner, position_type position, TElement&& element, const clean_up_function* clean_up = nullptr)
+        {
+            return undo_step::create<undo_step>(owner.resource, owner, operation_type::update, position, std::move(element), clean_up);
+        }
+
+        virtual void undo()
+        {
+            switch (operation) {
+                case operation_type::add:
+                    operation  = operation_type::remove;
+                    element    = owner->erase_element(position);
+                    hasElement = true;
+                    break;
+                case operation_type::remove:
+                    owner->restore_element(position, element);
+                    operation  = operation_type::add;
+                    hasElement = false;
+                    break;
+                case operation_type::update:
+                    owner->exchange_element(position, element);
+                    break;
+            }
+        }
+
+        virtual void redo()
+        {
+            undo();
+        }
+
+        virtual const std::pmr::vector<undo_step*>* get_data() const
+        {
+            return nullptr;
+        }
+
+        // Copies the step, its version included, for the history of owner.
+        undo_step* clone(undo_redo_collection& owner) const
+        {
+            auto step = duplicate(owner);
+            step->set_version(version);
+            return step;
+        }
+
+        virtual void rebind(undo_redo_collection& owner)
+        {
+            this->owner = &owner;
+        }
+
+        bool is_bound_to(const undo_redo_collection& owner) const
+        {
+            return this->owner == &owner;
+        }
+
+        // The histories of forked collections hold the same steps until one of them replays a step.
+        void share()
+        {
+            share_count.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        bool is_shared() const
+        {
+            return share_count.load(std::memory_order_acquire) > 1;
+        }
+
+        // Deletes the step once no history holds it.
+        static void release(undo_step* step)
+        {
+            if (step->share_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                destroy(step);
+        }
+
+    protected:
+        undo_redo_collection& get_owner() const
+        {
+            return *owner;
+        }
+
+        // Copies what is particular to the kind of step; clone() adds the version.
+        virtual undo_step* duplicate(undo_redo_collection& owner) const
+        {
+            auto step = undo_step::create<undo_step>(owner.resource, *this);
+            step->rebind(owner);
+            return step;
+        }
+
+    public:
+        // Public for std::construct_at in create(); undo_step is private to the collection all the same.
+        undo_step(undo_redo_collection& owner, operation_type operation, const clean_up_function* clean_up = nullptr)
+            : owner(&owner), operation(operation), position(), element(), hasElement(false), clean_up(clean_up), version(0), share_count(1)
+        {}
+
+        undo_step(undo_redo_collection& owner, operation_type operation, position_type position, const clean_up_function* clean_up = nullptr)
+            : owner(&owner), operation(operation), position(position), element(), hasElement(false), clean_up(clean_up), version(0), share_count(1)
+        {}
+
+        undo_step(undo_redo_collection& owner, operation_type operation, position_type position, TElement element, const clean_up_function* clean_up = nullptr)
+            : owner(&owner), operation(operation), position(position), element(std::move(element)), hasElement(true), clean_up(clean_up), version(0), share_count(1)
+        {}
+
+        // A copy starts out held by one history.
+        undo_step(const undo_step& step)
+            : owner(step.owner), operation(step.operation), position(step.position), element(step.element), hasElement(step.hasElement), clean_up(step.clean_up), version(step.version), share_count(1)
+        {}
+    };
+
+    // Add, remove and update steps of a transaction are kept in columns: one array of operations, one of positions
+    // and one of elements, so that replaying a large group streams through them instead of visiting one step object each.
+    // Any other step is kept as is and takes one entry of the columns as a placeholder.
+    class undo_step_group : public undo_step
+    {
+        using operation_type = typename undo_step::operation_type;
+        using run            = std::pair<std::size_t, std::size_t>;
+
+        std::pmr::vector<operation_type> operations;
+        std::pmr::vector<position_type>  positions;
+        std::pmr::vector<TElement>       elements;
+        std::pmr::vector<undo_step*>     boxed_steps;
+        std::pmr::vector<run>            parallel_runs;
+        const clean_up_function* const   clean_up;
+        std::size_t                      sealed_size;
+        bool                             analyzed;
+
+    public:
+        // Progress of an undo or a redo done in slices: the first index operations are in their redone state,
+        // and boxed of them are boxed steps.
+        struct cursor
+        {
+            std::size_t index;
+            std::size_t boxed;
+        };
+
+        undo_step_group(undo_redo_collection& owner)
+            : undo_step(owner, operation_type::group), operations(owner.resource), positions(owner.resource), elements(owner.resource)
+            , boxed_steps(owner.resource), parallel_runs(owner.resource), clean_up(owner.clean_up), sealed_size(0), analyzed(false)
+        {}
+        
+        virtual ~undo_step_group()
+        {
+            if constexpr (!std::is_integral_v<position_type>) {
+                for (std::size_t index = 0; index < operations.size(); index++) {
+                    if (operations[index] == operation_type::remove)
+                        this->get_owner().release_element(positions[index]);
+                }
+            }
+            // The elements still held are cleaned up run by run, as spans of the elements column.
+            if (clean_up != nullptr) {
+                std::size_t first = 0;
+                for (std::size_t index = 0; index <= operations.size(); index++) {
+                    if (index < operations.size() && holds_element(index))
+                        continue;
+                    (*clean_up)(std::span<const TElement>(elements.data() + first, index - first));
+                    first = index + 1;
+                }
+            }
+            clean_up_batch batch(clean_up);
+            std::for_each(boxed_steps.begin(), boxed_steps.end(), [](undo_step* step) { undo_step::destroy(step); });
+        }
+
+        virtual const std::pmr::vector<undo_step*>* get_data() const override
+        {
+            return &boxed_steps;
+        }
+
+        virtual undo_step* duplicate(undo_redo_collection& owner) const override
+        {
+            auto group = undo_step::template create<undo_step_group>(owner.resource, owner);
+            group->operations.assign(operations.begin(), operations.end());
+            group->positions .assign(positions .begin(), positions .end());
+            group->elements  .assign(elements  .begin(), elements  .end());
+            group->sealed_size = sealed_size;
+            std::for_each(boxed_steps.begin(), boxed_steps.end(), [&](undo_step* step) { group->boxed_steps.push_back(step->clone(owner)); });
+            return group;
+        }
+
+        virtual void rebind(undo_redo_collection& owner) override
+        {
+            undo_step::rebind(owner);
+            std::for_each(boxed_steps.begin(), boxed_steps.end(), [&](undo_step* step) { step->rebind(owner); });
+        }
+        
+        size_t size() const
+        {
+            return operations.size();
+        }
+
+        // Records an operation already applied to the collection. element is the removed or the replaced one.
+        void record(operation_type operation, position_type position, TElement element = TElement())
+        {
+            operations.push_back(operation);
+            positions .push_back(position);
+            elements  .push_back(std::move(element));
+        }
+
+        void push_back(undo_step* step)
+        {
+            record(step->get_operation_type(), position_type());
+            boxed_steps.push_back(step);
+        }
+
+        // Returns the last step if later steps may be merged into it, that is, if no savepoint has been taken since it was pushed.
+        undo_step* mergeable_back() const
         {
-            collection.push_back(element);
-            return new undo_step(collection, operation_type::add, collection.size() - 1, clean_up);
+            return operations.size() > sealed_size && is_boxed(operations.size() - 1) ? boxed_steps.back() : nullptr;
         }
 
-        static undo_step* remove(TCollection& collection, std::size_t index, const clean_up_function* clean_up = nullptr)
-        {
-            auto element = collection[index];
-            collection.erase(collection.begin() + index);
-            return new undo_step(collection, operation_type::remove, index, element, clean_up);
-        }
+        std::size_t seal()
+        {
+            sealed_size = operations.size();
+            return sealed_size;
+        }
+
+        // Undoes and discards the steps after the first size ones.
+        void rollback(std::size_t size)
+        {
+            while (operations.size() > size) {
+                auto index = operations.size() - 1;
+                if (is_boxed(index)) {
+                    boxed_steps.back()->undo();
+                    undo_step::destroy(boxed_steps.back());
+                    boxed_steps.pop_back();
+                } else {
+                    toggle(index);
+                    discard(index);
+                }
+                operations.pop_back();
+                positions .pop_back();
+                elements  .pop_back();
+            }
+        }
+
+        virtual void undo() override
+        {
+            auto position = end();
+            undo_down_to(0, position);
+        }
+
+        virtual void redo() override
+        {
+            auto position = cursor{ 0, 0 };
+            redo_up_to(operations.size(), position);
+        }
+
+        cursor end() const
+        {
+            return { operations.size(), boxed_steps.size() };
+        }
+
+        // Undoes the operations from position down to first, last one first, and moves position along.
+        void undo_down_to(std::size_t first, cursor& position)
+        {
+            analyze();
+            // The last run that starts before position. Parts of a run can be applied on their own, since its updates commute.
+            auto next_run = std::make_reverse_iterator(std::lower_bound(parallel_runs.begin(), parallel_runs.end(), position.index,
+                                                                        [](const run& run, std::size_t index) { return run.first < index; }));
+            while (position.index > first) {
+                if (next_run != parallel_runs.rend() && next_run->second >= position.index) {
+                    auto begin = std::max(next_run->first, first);
+                    apply(begin, position.index);
+                    position.index = begin;
+                    if (position.index == next_run->first)
+                        ++next_run;
+                } else if (is_boxed(--position.index)) {
+                    boxed_steps[--position.boxed]->undo();
+                } else {
+                    toggle(position.index);
+                }
+            }
+        }
+
+        // Redoes the operations from position up to last, first one first, and moves position along.
+        void redo_up_to(std::size_t last, cursor& position)
+        {
+            analyze();
+            // The first run that ends after position.
+            auto next_run = std::upper_bound(parallel_runs.begin(), parallel_runs.end(), position.index,
+                                             [](std::size_t index, const run& run) { return index < run.second; });
+            while (position.index < last) {
+                if (next_run != parallel_runs.end() && next_run->first <= position.index) {
+                    auto end = std::min(next_run->second, last);
+                    apply(position.index, end);
+                    position.index = end;
+                    if (position.index == next_run->second)
+                        ++next_run;
+                } else if (is_boxed(position.index)) {
+                    boxed_steps[position.boxed++]->redo();
+                    position.index++;
+                } else {
+                    toggle(position.index++);
+                }
+            }
+        }
+
+    private:
+        bool is_boxed(std::size_t index) const
+        {
+            return operations[index] != operation_type::add && operations[index] != operation_type::remove && operations[index] != operation_type::update;
+        }
+
+        // The removed or the replaced element of a remove or an update.
+        bool holds_element(std::size_t index) const
+        {
+            return operations[index] == operation_type::remove || operations[index] == operation_type::update;
+        }
+
+        // Undoes or redoes one add, remove or update, the same way undo_step does.
+        void toggle(std::size_t index)
+        {
+            auto& owner = this->get_owner();
+            switch (operations[index]) {
+                case operation_type::add:
+                    operations[index] = operation_type::remove;
+                    elements  [index] = owner.erase_element(positions[index]);
+                    break;
+                case operation_type::remove:
+                    owner.restore_element(positions[index], elements[index]);
+                    operations[index] = operation_type::add;
+                    elements  [index] = TElement();
+                    break;
+                case operation_type::update:
+                    owner.exchange_element(positions[index], elements[index]);
+                    break;
+            }
+        }
+
+        void discard(std::size_t index)
+        {
+            if (is_boxed(index))
+                return;
+
+            if constexpr (!std::is_integral_v<position_type>) {
+                if (operations[index] == operation_type::remove)
+                    this->get_owner().release_element(positions[index]);
+            }
+            if (holds_element(index) && clean_up != nullptr)
+                (*clean_up)(elements[index]);
+        }
+
+        // Finds the runs of consecutive updates on distinct positions. They commute, so each run can be applied in parallel.
+        void analyze()
+        {
+            if (analyzed)
+                return;
+            analyzed = true;
+
+            if constexpr (std::is_integral_v<position_type> && parallel::enabled) {
+                auto threshold = this->get_owner().parallel_threshold;
+                for (std::size_t first = 0; first < operations.size(); ) {
+                    auto last = first;
+                    while (last < operations.size() && operations[last] == operation_type::update)
+                        last++;
+
+                    if (last - first >= threshold && are_distinct(first, last))
+                        parallel_runs.push_back({ first, last });
+                    first = std::max(last, first + 1);
+                }
+            }
+        }
+
+        bool are_distinct(std::size_t first, std::size_t last) const
+        {
+            std::pmr::vector<position_type> sorted(positions.begin() + first, positions.begin() + last, positions.get_allocator());
+            parallel::sort(sorted.begin(), sorted.end());
+            return std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end();
+        }
+
+        void apply(std::size_t first, std::size_t last)
+        {
+            this->get_owner().exchange_elements(positions, elements, first, last);
+        }
+    };
+
+    // Reorders the range [first, last) as a whole. A sort keeps only the permutation, reverse and rotate keep nothing but the range.
+    class reorder_step : public undo_step
+    {
+    public:
+        enum class reorder_type
+        {
+            permute,
+            reverse,
+            rotate
+        };
+
+    private:
+        reorder_type                     type;
+        std::size_t                      first;
+        std::size_t                      middle;
+        std::size_t                      last;
+        std::pmr::vector<std::uint32_t>  permutation;
+
+    public:
+        reorder_step(undo_redo_collection& owner, reorder_type type, std::size_t first, std::size_t middle, std::size_t last, std::pmr::vector<std::uint32_t> permutation)
+            : undo_step(owner, undo_step::operation_type::reorder), type(type), first(first), middle(middle), last(last), permutation(std::move(permutation))
+        {}
+
+        virtual undo_step* duplicate(undo_redo_collection& owner) const override
+        {
+            return undo_step::template create<reorder_step>(owner.resource, owner, type, first, middle, last, std::pmr::vector<std::uint32_t>(permutation, owner.resource));
+        }
+
+        virtual void undo() override
+        {
+            this->get_owner().reorder_elements(first, last, [&](auto begin, auto end) {
+                switch (type) {
+                    case reorder_type::permute:
+                        unpermute(begin, permutation);
+                        break;
+                    case reorder_type::reverse:
+                        std::reverse(begin, end);
+                        break;
+                    case reorder_type::rotate:
+                        std::rotate(begin, std::next(begin, last - middle), end);
+                        break;
+                }
+            });
+        }
+
+        virtual void redo() override
+        {
+            this->get_owner().reorder_elements(first, last, [&](auto begin, auto end) {
+                switch (type) {
+                    case reorder_type::permute:
+                        permute(begin, permutation);
+                        break;
+                    case reorder_type::reverse:
+                        std::reverse(begin, end);
+                        break;
+                    case reorder_type::rotate:
+                        std::rotate(begin, std::next(begin, middle - first), end);
+                        break;
+                }
+            });
+        }
+
+    private:
+        // After permute(), the element at index came from permutation[index].
+        static void permute(typename TCollection::iterator begin, const std::pmr::vector<std::uint32_t>& permutation)
+        {
+            std::pmr::vector<TElement> elements(std::make_move_iterator(begin), std::make_move_iterator(std::next(begin, permutation.size())), permutation.get_allocator());
+            for (std::size_t index = 0; index < permutation.size(); index++)
+                begin[index] = std::move(elements[permutation[index]]);
+        }
+
+        static void unpermute(typename TCollection::iterator begin, const std::pmr::vector<std::uint32_t>& permutation)
+        {
+            std::pmr::vector<TElement> elements(std::make_move_iterator(begin), std::make_move_iterator(std::next(begin, permutation.size())), permutation.get_allocator());
+            for (std::size_t index = 0; index < permutation.size(); index++)
+                begin[permutation[index]] = std::move(elements[index]);
+        }
+    };
+
+    // Updates the range starting at first as a whole. The values are kept contiguously and swapped with the range,
+    // so that the step holds the old values after redo and the new ones after undo.
+    class range_update_step : public undo_step
+    {
+        std::size_t                    first;
+        std::pmr::vector<TElement>     elements;
+        const clean_up_function* const clean_up;
+
+    public:
+        range_update_step(undo_redo_collection& owner, std::size_t first, std::pmr::vector<TElement> elements, const clean_up_function* clean_up = nullptr)
+            : undo_step(owner, undo_step::operation_type::range), first(first), elements(std::move(elements)), clean_up(clean_up)
+        {}
+
+        virtual undo_step* duplicate(undo_redo_collection& owner) const override
+        {
+            return undo_step::template create<range_update_step>(owner.resource, owner, first, std::pmr::vector<TElement>(elements, owner.resource), clean_up);
+        }
+
+        virtual ~range_update_step()
+        {
+            if (clean_up != nullptr)
+                (*clean_up)(std::span<const TElement>(elements));
+        }
+
+        virtual void undo() override
+        {
+            this->get_owner().exchange_elements(first, elements);
+        }
+
+        virtual void redo() override
+        {
+            undo();
+        }
+    };
+
+    // Consecutive push_backs at the tail, kept as a start and a count. Undo truncates the collection once;
+    // the truncated elements are kept only until redo appends them again.
+    class append_run_step : public undo_step
+    {
+        std::size_t                    first;
+        std::size_t                    count;
+        std::pmr::vector<TElement>     elements;
+        const clean_up_function* const clean_up;
+
+    public:
+        append_run_step(undo_redo_collection& owner, std::size_t first, const clean_up_function* clean_up = nullptr)
+            : undo_step(owner, undo_step::operation_type::append), first(first), count(0), elements(owner.resource), clean_up(clean_up)
+        {}
+
+        virtual undo_step* duplicate(undo_redo_collection& owner) const override
+        {
+            auto step   = undo_step::template create<append_run_step>(owner.resource, owner, first, clean_up);
+            step->count = count;
+            step->elements.assign(elements.begin(), elements.end());
+            return step;
+        }
+
+        virtual ~append_run_step()
+        {
+            if (clean_up != nullptr)
+                (*clean_up)(std::span<const TElement>(elements));
+        }
+
+        std::size_t append(const TElement& element)
+        {
+            count++;
+            return this->get_owner().append_element(element);
+        }
+
+        virtual void undo() override
+        {
+            this->get_owner().truncate_elements(first, elements);
+        }
+
+        virtual void redo() override
+        {
+            this->get_owner().append_elements(elements);
+        }
+    };
+
+    // Erases the elements at indices, which are ascending, in one stable compaction pass and puts them back in one merge pass.
+    // The erased elements are kept only until redo erases them again.
+    class compaction_step : public undo_step
+    {
+        std::pmr::vector<std::size_t>  indices;
+        std::pmr::vector<TElement>     elements;
+        const clean_up_function* const clean_up;
+
+    public:
+        compaction_step(undo_redo_collection& owner, std::pmr::vector<std::size_t> indices, const clean_up_function* clean_up = nullptr)
+            : undo_step(owner, undo_step::operation_type::compact), indices(std::move(indices)), elements(owner.resource), clean_up(clean_up)
+        {}
+
+        virtual undo_step* duplicate(undo_redo_collection& owner) const override
+        {
+            auto step = undo_step::template create<compaction_step>(owner.resource, owner, std::pmr::vector<std::size_t>(indices, owner.resource), clean_up);
+            step->elements.assign(elements.begin(), elements.end());
+            return step;
+        }
+
+        virtual ~compaction_step()
+        {
+            if (clean_up != nullptr)
+                (*clean_up)(std::span<const TElement>(elements));
+        }
+
+        virtual void undo() override
+        {
+            this->get_owner().merge_elements(indices, elements);
+        }
+
+        virtual void redo() override
+        {
+            this->get_owner().compact_elements(indices, elements);
+        }
+    };
+
+    // The steps, shared by the collections forked from each other until one of them changes them.
+    // A history detached from a shared one keeps that one, which no longer changes, as its base: its first base_size steps
+    // are those of the base, and steps holds the rest. Steps are taken over from the base, by pointer, only to be replayed.
+    struct undo_history
+    {
+        std::shared_ptr<undo_history> base;
+        std::size_t                   base_size;
+        std::pmr::vector<undo_step*>  steps;
+
+        undo_history(std::pmr::memory_resource* resource) : base_size(0), steps(resource)
+        {}
+
+        undo_history(std::pmr::memory_resource* resource, std::shared_ptr<undo_history> base)
+            : base(base), base_size(base->size()), steps(resource)
+        {}
+
+        ~undo_history()
+        {
+            clear();
+        }
+
+        std::size_t size() const
+        {
+            return base_size + steps.size();
+        }
+
+        undo_step* at(std::size_t index) const
+        {
+            return index < base_size ? base->at(index) : steps[index - base_size];
+        }
+
+        // Takes over the steps of the base from index on, and at least as many as steps holds, so that taking them over
+        // one undo at a time is amortized O(1). The steps taken over are shared with the base.
+        undo_step*& take(std::size_t index)
+        {
+            if (index < base_size) {
+                auto first = base_size - std::min(base_size, std::max(base_size - index, steps.size() + 1));
+                std::pmr::vector<undo_step*> taken(steps.get_allocator());
+                taken.reserve(std::max(base_size - first + steps.size(), steps.capacity()));
+                for (auto position = first; position < base_size; position++) {
+                    auto step = base->at(position);
+                    step->share();
+                    taken.push_back(step);
+                }
+                taken.insert(taken.end(), steps.begin(), steps.end());
+                steps.swap(taken);
+                base_size = first;
+                if (base_size == 0)
+                    base.reset();
+            }
+            return steps[index - base_size];
+        }
+
+        // Discards the steps from index on.
+        void truncate(std::size_t index)
+        {
+            auto first = index < base_size ? std::size_t(0) : index - base_size;
+            std::for_each(steps.begin() + first, steps.end(), [](undo_step* step) { undo_step::release(step); });
+            steps.erase(steps.begin() + first, steps.end());
+            if (index < base_size)
+                base_size = index;
+            if (base_size == 0)
+                base.reset();
+        }
+
+        void clear()
+        {
+            truncate(0);
+        }
+    };
+
+    // An undo or a redo done in slices that has not finished yet.
+    enum class pending_type
+    {
+        none,
+        undo,
+        redo
+    };
+
+    using group_cursor = typename undo_step_group::cursor;
+
+    std::pmr::memory_resource* const resource;
+    std::shared_ptr<TCollection>     data;
+    adapter_type                     adapter;
+    size_t                           undo_steps_index;
+    std::shared_ptr<undo_history>    history;
+    undo_step_group*                 current_undo_step_group;
+    std::size_t                      transaction_depth;
+    const clean_up_function* const   clean_up;
+    std::size_t                      last_version;
+    std::size_t                      base_version;
+    std::size_t                      saved_version;
+    std::pmr::vector<observer*>      observers;
+    std::size_t                      parallel_threshold;
+    std::size_t                      shrink_factor;
+    std::size_t                      reserved_element_count;
+    std::size_t                      reserved_step_count;
+    pending_type                     pending;
+    group_cursor                     pending_position;
+
+public:
+    using iterator       = typename TCollection::iterator;
+    using const_iterator = typename TCollection::const_iterator;
+
+    static constexpr std::size_t default_parallel_threshold = 4096;
+    static constexpr std::size_t default_shrink_factor      = 4;
+    // Operations undo_for() and redo_for() process between two looks at the clock.
+    static constexpr std::size_t time_slice_size            = 1024;
+
+    undo_redo_collection() : undo_redo_collection(std::pmr::get_default_resource())
+    {}
+
+    // Every allocation of the collection, its steps and the elements they keep comes from resource.
+    // The elements themselves do as well when TCollection uses std::pmr::polymorphic_allocator.
+    explicit undo_redo_collection(std::pmr::memory_resource* resource)
+        : resource(resource), data(make_data()), undo_steps_index(0), history(make_history())
+        , current_undo_step_group(nullptr), transaction_depth(0), clean_up(nullptr), last_version(0), base_version(0), saved_version(0)
+        , observers(resource), parallel_threshold(default_parallel_threshold), shrink_factor(default_shrink_factor), reserved_element_count(0), reserved_step_count(0), pending(pending_type::none), pending_position{ 0, 0 }
+    {}
+
+    undo_redo_collection(std::function<void(TElement)> clean_up, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : resource(resource), data(make_data()), undo_steps_index(0), history(make_history())
+        , current_undo_step_group(nullptr), transaction_depth(0), clean_up(new clean_up_function(clean_up, resource)), last_version(0), base_version(0), saved_version(0)
+        , observers(resource), parallel_threshold(default_parallel_threshold), shrink_factor(default_shrink_factor), reserved_element_count(0), reserved_step_count(0), pending(pending_type::none), pending_position{ 0, 0 }
+    {}
+
+    // clean_up receives the elements no longer held in spans: the elements of the collection at once on reset() and destruction,
+    // and those of discarded steps up to a thousand or so at a time, so that they can be released in bulk.
+    undo_redo_collection(std::function<void(std::span<const TElement>)> clean_up, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : resource(resource), data(make_data()), undo_steps_index(0), history(make_history())
+        , current_undo_step_group(nullptr), transaction_depth(0), clean_up(new clean_up_function(clean_up, resource)), last_version(0), base_version(0), saved_version(0)
+        , observers(resource), parallel_threshold(default_parallel_threshold), shrink_factor(default_shrink_factor), reserved_element_count(0), reserved_step_count(0), pending(pending_type::none), pending_position{ 0, 0 }
+    {}
+
+    virtual ~undo_redo_collection()
+    {
+        reset_undo_steps();
+        if (clean_up != nullptr) {
+            clean_up_elements();
+            delete clean_up;
+        }
+    }
+
+    const TElement& operator[](size_t index) const
+    {
+        return (*data)[index];
+    }
+
+    size_t size() const
+    {
+        return data->size();
+    }
+
+    iterator begin()
+    {
+        detach_data();
+        return data->begin();
+    }
+
+    iterator end()
+    {
+        detach_data();
+        return data->end();
+    }
+
+    const_iterator cbegin() const
+    {
+        return data->cbegin();
+    }
+
+    const_iterator cend() const
+    {
+        return data->cend();
+    }
+
+    void clear()
+    {
+        {
+            transaction transaction(*this);
+            while (data->size() > 0)
+                erase(begin());
+        }
+        if (shrink_factor != 0)
+            shrink_elements(shrink_factor);
+    }
+
+    void reset()
+    {
+        reset_undo_steps();
+        clean_up_elements();
+        if (shrink_factor != 0) {
+            shrink_elements(shrink_factor);
+            shrink_history(shrink_factor);
+        }
+        std::for_each(observers.begin(), observers.end(), [](observer* observer) { observer->on_reset(); });
+    }
+
+    void push_back(TElement element)
+    {
+        append(element);
+    }
+
+    // Appends every element of range as one undoable step.
+    template <typename TRange>
+    void append_range(const TRange& range)
+    {
+        transaction transaction(*this);
+        std::for_each(std::begin(range), std::end(range), [&](const TElement& element) { append(element); });
+    }
+
+    void insert(iterator before, TElement element)
+    {
+        throw_if_pending();
+
+        if (current_undo_step_group != nullptr) {
+            current_undo_step_group->record(undo_step::operation_type::add, insert_element(before, element));
+            return;
+        }
+
+        auto step = undo_step::insert(*this, before, element, clean_up);
+        push(step);
+    }
+
+    void erase(iterator iterator)
+    {
+        erase_at(adapter.position_of(*data, iterator));
+    }
+
+    void update(iterator iterator, TElement element)
+    {
+        update_at(adapter.position_of(*data, iterator), element);
+    }
+
+    void erase_at(position_type position)
+    {
+        throw_if_pending();
+
+        if (current_undo_step_group != nullptr) {
+            auto element = erase_element(position);
+            current_undo_step_group->record(undo_step::operation_type::remove, position, std::move(element));
+            return;
+        }
+
+        auto step = undo_step::remove(*this, position, clean_up);
+        push(step);
+    }
+
+    void update_at(position_type position, TElement element)
+    {
+        throw_if_pending();
+
+        if (current_undo_step_group != nullptr) {
+            exchange_element(position, element);
+            current_undo_step_group->record(undo_step::operation_type::update, position, std::move(element));
+            return;
+        }
+
+        auto step = undo_step::update(*this, position, element, clean_up);
+        push(step);
+    }
+
+    // Changes the element in place: function receives a mutable reference to it. The prior value is copied once
+    // and kept for undo as an update step. If function throws, the prior value is put back and nothing is recorded.
+    template <typename TFunction>
+    void modify(iterator iterator, TFunction function)
+    {
+        modify_at(adapter.position_of(*data, iterator), function);
+    }
+
+    template <typename TFunction>
+    void modify_at(position_type position, TFunction function)
+    {
+        auto  element = begin_modification(position);
+        auto& current = adapter.at(*data, position);
+        try {
+            function(current);
+        } catch (...) {
+            current = std::move(element);
+            throw;
+        }
+        end_modification(position, std::move(element));
+    }
+
+    // Mutable access to one element. Whatever is done through it is recorded as one update step when it goes out of scope,
+    // or undone if it goes out of scope by an exception. The collection must not be changed otherwise in the meantime.
+    class element_editor
+    {
+        undo_redo_collection& collection;
+        const position_type   position;
+        TElement              element;
+        const int             uncaught_exceptions;
+
+    public:
+        element_editor(undo_redo_collection& collection, position_type position)
+            : collection(collection), position(position), element(collection.begin_modification(position)), uncaught_exceptions(std::uncaught_exceptions())
+        {}
+
+        virtual ~element_editor()
+        {
+            if (std::uncaught_exceptions() > uncaught_exceptions)
+                **this = std::move(element);
+            else
+                collection.end_modification(position, std::move(element));
+        }
+
+        element_editor(const element_editor&)            = delete;
+        element_editor& operator=(const element_editor&) = delete;
+
+        TElement& operator*() const
+        {
+            return collection.adapter.at(*collection.data, position);
+        }
+
+        TElement* operator->() const
+        {
+            return &**this;
+        }
+    };
+
+    element_editor edit(iterator iterator)
+    {
+        return element_editor(*this, adapter.position_of(*data, iterator));
+    }
+
+    element_editor edit_at(position_type position)
+    {
+        return element_editor(*this, position);
+    }
+
+    // Sorts [first, last) as one undoable step that keeps only the permutation.
+    // Ranges of at least the parallel threshold are sorted in parallel, so compare has to be safe to call concurrently.
+    template <typename TCompare = std::less<>>
+    void sort(iterator first, iterator last, TCompare compare = TCompare())
+    {
+        sort_by_permutation(first, last, compare, false);
+    }
+
+    template <typename TCompare = std::less<>>
+    void stable_sort(iterator first, iterator last, TCompare compare = TCompare())
+    {
+        sort_by_permutation(first, last, compare, true);
+    }
+
+    void reverse(iterator first, iterator last)
+    {
+        if (std::distance(first, last) > 1)
+            reorder(reorder_step::reorder_type::reverse, first, first, last);
+    }
+
+    void rotate(iterator first, iterator middle, iterator last)
+    {
+        if (first != middle && middle != last)
+            reorder(reorder_step::reorder_type::rotate, first, middle, last);
+    }
+
+    // Replaces each element of [first, last) with function(element) as one undoable step.
+    // Ranges of at least the parallel threshold are transformed in parallel, so function has to be safe to call concurrently.
+    template <typename TFunction>
+    void transform(iterator first, iterator last, TFunction function)
+    {
+        std::pmr::vector<TElement> elements(std::distance(first, last), resource);
+        if (runs_in_parallel(elements.size())) {
+            if constexpr (std::is_integral_v<position_type>)
+                adapter.prepare_concurrent_access(*data, std::distance(data->begin(), first), std::distance(data->begin(), last));
+            parallel::transform(first, last, elements.begin(), function);
+        } else {
+            std::transform(first, last, elements.begin(), function);
+        }
+        push_range_update(first, std::move(elements));
+    }
+
+    // Replaces the elements from first on with elements as one undoable step.
+    void update_range(iterator first, std::vector<TElement> elements)
+    {
+        push_range_update(first, std::pmr::vector<TElement>(std::make_move_iterator(elements.begin()), std::make_move_iterator(elements.end()), resource));
+    }
+
+    // Erases every element that satisfies predicate as one undoable step. The tail is shifted once,
+    // not once per erased element, and undo puts the elements back in one pass as well. Returns the number erased.
+    template <typename TPredicate>
+    std::size_t erase_if(TPredicate predicate)
+    {
+        std::pmr::vector<std::size_t> indices(resource);
+        for (std::size_t index = 0; index < data->size(); index++) {
+            if (predicate((*data)[index]))
+                indices.push_back(index);
+        }
+        auto count = indices.size();
+        push_compaction(std::move(indices));
+        return count;
+    }
+
+    // Erases the elements at indices, given in any order, as one undoable step like erase_if().
+    template <typename TRange>
+    void erase_indices(const TRange& indices)
+    {
+        std::pmr::vector<std::size_t> sorted(std::begin(indices), std::end(indices), resource);
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+        if (!sorted.empty() && sorted.back() >= data->size())
+            throw std::out_of_range("erase_indices");
+
+        push_compaction(std::move(sorted));
+    }
+
+    // Runs of at least this many independent updates in a transaction are undone and redone in parallel.
+    // A transaction reads it when it is undone for the first time; SIZE_MAX turns parallel replay off.
+    // Without SHOS_UNDO_REDO_PARALLEL everything runs serially and the threshold has no effect.
+    void set_parallel_threshold(std::size_t threshold)
+    {
+        parallel_threshold = threshold;
+    }
+
+    // The elements after clear(), the history after discarding redo steps, and both after reset() are shrunk
+    // if their capacity exceeds factor times their size, but never below what reserve() and reserve_history() asked for.
+    // 0 turns shrinking off.
+    void set_shrink_factor(std::size_t factor)
+    {
+        shrink_factor = factor;
+    }
+
+    // Reserves room for element_count elements, when TCollection can reserve.
+    void reserve(std::size_t element_count)
+    {
+        if constexpr (requires(TCollection& collection) { collection.reserve(element_count); }) {
+            detach_data();
+            data->reserve(element_count);
+            reserved_element_count = element_count;
+        }
+    }
+
+    // Reserves room for step_count undo steps, so that recording them does not reallocate the history.
+    void reserve_history(std::size_t step_count)
+    {
+        detach_history();
+        history->steps.reserve(step_count);
+        reserved_step_count = step_count;
+    }
+
+    // Gives up the reservations as well.
+    void shrink_to_fit()
+    {
+        reserved_element_count = 0;
+        reserved_step_count    = 0;
+        shrink_elements(1);
+        shrink_history(1);
+    }
+
+    struct capacity_stats
+    {
+        std::size_t element_count;
+        std::size_t element_capacity;
+        std::size_t step_count;
+        std::size_t step_capacity;
+    };
+
+    // The element capacity is the size when TCollection has no capacity().
+    capacity_stats stats() const
+    {
+        auto element_capacity = data->size();
+        if constexpr (requires(const TCollection& collection) { collection.capacity(); })
+            element_capacity = data->capacity();
+        return { data->size(), element_capacity, history->size(), history->steps.capacity() };
+    }
+
+    void add_observer(observer& observer)
+    {
+        observers.push_back(&observer);
+    }
+
+    void remove_observer(observer& observer)
+    {
+        observers.erase(std::remove(observers.begin(), observers.end(), &observer), observers.end());
+    }
+
+    // A collection added to an undo_redo_manager undoes and redoes whole actions of the manager.
+    bool undo()
+    {
+        return get_manager() != nullptr ? get_manager()->undo() : undo_last_step();
+    }
+
+    bool redo()
+    {
+        return get_manager() != nullptr ? get_manager()->redo() : redo_next_step();
+    }
+
+    bool can_undo() const
+    {
+        return get_manager() != nullptr ? get_manager()->can_undo() : undo_steps_index != 0;
+    }
+
+    bool can_redo() const
+    {
+        return get_manager() != nullptr ? get_manager()->can_redo() : undo_steps_index != history->size();
+    }
+
+    // Undoes the last step a slice of at most count operations at a time, so that undoing a huge transaction
+    // does not block the caller. Returns false while the undo is pending, and true once it has finished
+    // or if there was nothing to undo. Steps other than transactions are undone in one slice.
+    // While an undo or a redo is pending, the elements are partly undone, the history and version() are unchanged,
+    // and undo(), redo() and transactions throw; the collection must not be changed otherwise either.
+    bool undo_slice(std::size_t count)
+    {
+        if (get_manager() != nullptr || pending == pending_type::redo)
+            throw std::logic_error("an exception occurred");
+
+        if (pending == pending_type::none) {
+            if (undo_steps_index == 0)
+                return true;
+            own_step(undo_steps_index - 1);
+            auto group = pending_group(undo_steps_index - 1);
+            if (group == nullptr)
+                return undo_last_step();
+            pending          = pending_type::undo;
+            pending_position = group->end();
+        }
+
+        auto group = pending_group(undo_steps_index - 1);
+        group->undo_down_to(pending_position.index > count ? pending_position.index - count : 0, pending_position);
+        if (pending_position.index > 0)
+            return false;
+
+        pending = pending_type::none;
+        undo_steps_index--;
+        std::for_each(observers.begin(), observers.end(), [](observer* observer) { observer->on_undo(); });
+        return true;
+    }
+
+    bool redo_slice(std::size_t count)
+    {
+        if (get_manager() != nullptr || pending == pending_type::undo)
+            throw std::logic_error("an exception occurred");
+
+        if (pending == pending_type::none) {
+            if (undo_steps_index == history->size())
+                return true;
+            own_step(undo_steps_index);
+            auto group = pending_group(undo_steps_index);
+            if (group == nullptr)
+                return redo_next_step();
+            pending          = pending_type::redo;
+            pending_position = { 0, 0 };
+        }
+
+        auto group = pending_group(undo_steps_index);
+        auto size  = group->size();
+        group->redo_up_to(size - pending_position.index > count ? pending_position.index + count : size, pending_position);
+        if (pending_position.index < size)
+            return false;
+
+        pending = pending_type::none;
+        undo_steps_index++;
+        std::for_each(observers.begin(), observers.end(), [](observer* observer) { observer->on_redo(); });
+        return true;
+    }
+
+    // Undoes in slices until the undo has finished or budget has run out.
+    template <typename TRep, typename TPeriod>
+    bool undo_for(std::chrono::duration<TRep, TPeriod> budget)
+    {
+        auto deadline = std::chrono::steady_clock::now() + budget;
+        while (!undo_slice(time_slice_size)) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+        }
+        return true;
+    }
+
+    template <typename TRep, typename TPeriod>
+    bool redo_for(std::chrono::duration<TRep, TPeriod> budget)
+    {
+        auto deadline = std::chrono::steady_clock::now() + budget;
+        while (!redo_slice(time_slice_size)) {
+            if (std::chrono::steady_clock::now() >= deadline)
+                return false;
+        }
+        return true;
+    }
+
+    bool is_pending() const
+    {
+        return pending != pending_type::none;
+    }
+
+    // Puts back what the pending undo or redo has changed so far, in one go.
+    void cancel_pending()
+    {
+        switch (pending) {
+            case pending_type::undo: {
+                auto group = pending_group(undo_steps_index - 1);
+                group->redo_up_to(group->size(), pending_position);
+                break;
+            }
+            case pending_type::redo:
+                pending_group(undo_steps_index)->undo_down_to(0, pending_position);
+                break;
+        }
+        pending = pending_type::none;
+    }
+
+    // Identifies the current history state. Every recorded step gets a new, larger version,
+    // and undo/redo move back and forth between the versions of the states they restore.
+    std::size_t version() const
+    {
+        return undo_steps_index == 0 ? base_version : history->at(undo_steps_index - 1)->get_version();
+    }
+
+    bool has_changed_since(std::size_t version) const
+    {
+        return this->version() != version;
+    }
+
+    void mark_saved()
+    {
+        saved_version = version();
+    }
+
+    bool is_modified() const
+    {
+        return has_changed_since(saved_version);
+    }
+
+    // Returns a copy that shares the elements and the history with this collection in O(1).
+    // Whichever side writes to the elements first, or calls a non-const begin() / end(), copies them: all of them,
+    // or with chunked_vector as TCollection only the chunks it writes to. The history is copied as pointers to its steps
+    // on an operation, an undo or a redo, and a step is copied only when that side undoes or redoes it.
+    // Iterators into this collection are invalidated.
+    undo_redo_collection fork()
+    {
+        static_assert(std::is_integral_v<position_type>, "fork needs a random access collection");
+
+        // Both sides would clean up the shared elements, and an open transaction or a pending undo cannot be split.
+        if (clean_up != nullptr || current_undo_step_group != nullptr || pending != pending_type::none)
+            throw std::logic_error("an exception occurred");
+
+        return undo_redo_collection(*this, data, history);
+    }
+
+    // Marks the current end of the open transaction. rollback_to() undoes and discards what was recorded after it.
+    std::size_t savepoint()
+    {
+        if (current_undo_step_group == nullptr)
+            throw std::logic_error("an exception occurred");
+
+        return current_undo_step_group->seal();
+    }
+
+    virtual void rollback_to(std::size_t savepoint) override
+    {
+        if (current_undo_step_group == nullptr || savepoint > current_undo_step_group->size())
+            throw std::logic_error("an exception occurred");
 
-        static undo_step* update(TCollection& collection, std::size_t index, TElement element, const clean_up_function* clean_up = nullptr)
-        {
-            std::swap(element, collection[index]);
-            return new undo_step(collection, operation_type::update, index, element, clean_up);
-        }
+        current_undo_step_group->rollback(savepoint);
+    }
 
-        virtual void undo()
-        {
-            switch (operation) {
-                case operation_type::add:
-                    operation  = operation_type::remove;
-                    element    = collection[index];
-                    hasElement = true;
-                    collection.erase(std::next(collection.begin(), index));
-                    break;
-                case operation_type::remove:
-                    collection.insert(std::next(collection.begin(), index), element);
-                    operation  = operation_type::add;
-                    hasElement = false;
-                    break;
-                case operation_type::update:
-                    std::swap(collection[index], element);
-                    break;
-            }
-        }
+    // Transactions nest: an inner one only adds its steps to the outermost one, which records them as one group.
+    // A transaction left by an exception rolls back its own steps, so a failed outermost one records nothing.
+    class transaction
+    {
+        undo_redo_collection<TElement, TCollection>& collection;
+        const std::size_t                            savepoint;
+        const int                                    uncaught_exceptions;
+        
+    public:
+        transaction(undo_redo_collection<TElement, TCollection>& collection)
+            : collection(collection), savepoint(collection.begin_transaction()), uncaught_exceptions(std::uncaught_exceptions())
+        {}
 
-        virtual void redo()
+        virtual ~transaction()
         {
-            undo();
+            if (std::uncaught_exceptions() > uncaught_exceptions)
+                collection.rollback_to(savepoint);
+            collection.end_transaction();
         }
+    };
+    
+protected:
+    const TCollection& get_collection() const
+    {
+        return *data;
+    }
 
-        virtual const std::vector<undo_step*>* get_data() const
-        {
-            return nullptr;
-        }
+    // In a transaction, push_backs onto a random access collection are merged into one append run.
+    position_type append(TElement element)
+    {
+        throw_if_pending();
 
-    protected:
-        undo_step(TCollection& collection, operation_type operation, const clean_up_function* clean_up = nullptr)
-            : collection(collection), operation(operation), index(0), element(), hasElement(false), clean_up(clean_up)
-        {}
+        if constexpr (std::is_integral_v<position_type>) {
+            if (current_undo_step_group != nullptr) {
+                auto back = current_undo_step_group->mergeable_back();
+                if (back != nullptr && back->get_operation_type() == undo_step::operation_type::append)
+                    return static_cast<append_run_step*>(back)->append(element);
 
-    private:
-        undo_step(TCollection& collection, operation_type operation, std::size_t index, const clean_up_function* clean_up = nullptr)
-            : collection(collection), operation(operation), index(index), element(), hasElement(false), clean_up(clean_up)
-        {}
+                auto run = undo_step::template create<append_run_step>(resource, *this, data->size(), clean_up);
+                push_to_group(run);
+                return run->append(element);
+            }
+        } else if (current_undo_step_group != nullptr) {
+            auto position = append_element(element);
+            current_undo_step_group->record(undo_step::operation_type::add, position);
+            return position;
+        }
 
-        undo_step(TCollection& collection, operation_type operation, std::size_t index, TElement element, const clean_up_function* clean_up = nullptr)
-            : collection(collection), operation(operation), index(index), element(element), hasElement(true), clean_up(clean_up)
-        {}
-    };
+        auto step     = undo_step::add(*this, element, clean_up);
+        auto position = step->get_position();
+        push(step);
+        return position;
+    }
 
-    class undo_step_group : public undo_step
+private:
+    undo_redo_collection(const undo_redo_collection& source, std::shared_ptr<TCollection> data, std::shared_ptr<undo_history> history)
+        : resource(source.resource), data(data), undo_steps_index(source.undo_steps_index), history(history)
+        , current_undo_step_group(nullptr), transaction_depth(0), clean_up(nullptr), last_version(source.last_version), base_version(source.base_version), saved_version(source.saved_version)
+        , observers(source.resource), parallel_threshold(source.parallel_threshold), shrink_factor(source.shrink_factor), reserved_element_count(source.reserved_element_count), reserved_step_count(source.reserved_step_count), pending(pending_type::none), pending_position{ 0, 0 }
+    {}
+
+    // polymorphic_allocator constructs a TCollection that uses it with the same memory resource.
+    template <typename... TArguments>
+    std::shared_ptr<TCollection> make_data(TArguments&&... arguments) const
     {
-        std::vector<undo_step*> undo_steps;
+        return std::allocate_shared<TCollection>(std::pmr::polymorphic_allocator<TCollection>(resource), std::forward<TArguments>(arguments)...);
+    }
 
-    public:
-        using iterator       = typename std::vector<undo_step*>::iterator;
-        using const_iterator = typename std::vector<undo_step*>::const_iterator;
+    template <typename... TArguments>
+    std::shared_ptr<undo_history> make_history(TArguments&&... arguments)
+    {
+        return std::allocate_shared<undo_history>(std::pmr::polymorphic_allocator<undo_history>(resource), resource, std::forward<TArguments>(arguments)...);
+    }
 
-        undo_step_group(TCollection& collection) : undo_step(collection, undo_step::operation_type::group)
-        {}
-        
-        virtual ~undo_step_group()
-        {
-            std::for_each(undo_steps.begin(), undo_steps.end(), [](undo_step* step) { delete step; });
-        }
+    void detach_data()
+    {
+        if (data.use_count() > 1)
+            data = make_data(*data);
+    }
 
-        virtual const std::vector<undo_step*>* get_data() const override
-        {
-            return &undo_steps;
-        }
-        
-        size_t size() const
-        {
-            return undo_steps.size();
+    // Makes the history exclusive to this collection in O(1): the shared one becomes its base.
+    void detach_history()
+    {
+        if (history.use_count() > 1) {
+            history = make_history(history);
+            history->steps.reserve(reserved_step_count);
         }
+    }
 
-        void push_back(undo_step* step)
-        {
-            undo_steps.push_back(step);
+    // Makes the step at index exclusive to this collection and bound to it, before it is replayed.
+    undo_step* own_step(std::size_t index)
+    {
+        detach_history();
+        auto& step = history->take(index);
+        if (step->is_shared()) {
+            auto copy = step->clone(*this);
+            undo_step::release(step);
+            step = copy;
+        } else if (!step->is_bound_to(*this)) {
+            step->rebind(*this);
         }
+        return step;
+    }
 
-        iterator begin()
-        {
-            return undo_steps.begin();
-        }
+    virtual std::size_t begin_transaction() override
+    {
+        if (pending != pending_type::none)
+            throw std::logic_error("an exception occurred");
 
-        iterator end()
-        {
-            return undo_steps.end();
-        }
+        if (transaction_depth++ == 0)
+            current_undo_step_group = undo_step::template create<undo_step_group>(resource, *this);
+        return current_undo_step_group->seal();
+    }
 
-        const_iterator cbegin() const
-        {
-            return undo_steps.cbegin();
-        }
+    virtual void end_transaction() override
+    {
+        if (current_undo_step_group == nullptr)
+            throw std::logic_error("an exception occurred");
 
-        const_iterator cend() const
-        {
-            return undo_steps.cend();
-        }
+        if (--transaction_depth > 0)
+            return;
 
-        virtual void undo() override
-        {
-            std::for_each(undo_steps.rbegin(), undo_steps.rend(), [](undo_step* step) { step->undo(); });
-        }
+        if (current_undo_step_group->size() == 0)
+            undo_step::destroy(current_undo_step_group);
+        else
+            push_to_steps(current_undo_step_group);
+        current_undo_step_group = nullptr;
+    }
+    
+    virtual bool undo_last_step() override
+    {
+        if (pending != pending_type::none)
+            throw std::logic_error("an exception occurred");
+        if (undo_steps_index == 0)
+            return false;
 
-        virtual void redo() override
-        {
-            std::for_each(undo_steps.begin(), undo_steps.end(), [](undo_step* step) { step->undo(); });
-        }
-    };
+        own_step(undo_steps_index - 1)->undo();
+        undo_steps_index--;
+        std::for_each(observers.begin(), observers.end(), [](observer* observer) { observer->on_undo(); });
+        return true;
+    }
 
-    TCollection                    data;
-    size_t                         undo_steps_index;
-    std::vector<undo_step*>        undo_steps;
-    undo_step_group*               current_undo_step_group;
-    const clean_up_function* const clean_up;
+    virtual bool redo_next_step() override
+    {
+        if (pending != pending_type::none)
+            throw std::logic_error("an exception occurred");
+        if (undo_steps_index == history->size())
+            return false;
 
-public:
-    using iterator       = typename TCollection::iterator;
-    using const_iterator = typename TCollection::const_iterator;
+        own_step(undo_steps_index)->redo();
+        undo_steps_index++;
+        std::for_each(observers.begin(), observers.end(), [](observer* observer) { observer->on_redo(); });
+        return true;
+    }
 
-    undo_redo_collection() : undo_steps_index(0), current_undo_step_group(nullptr), clean_up(nullptr)
-    {}
+    virtual void discard_redo_steps() override
+    {
+        if (undo_steps_index == history->size())
+            return;
+
+        detach_history();
+        clean_up_batch batch(clean_up);
+        history->truncate(undo_steps_index);
+        if (shrink_factor != 0)
+            shrink_history(shrink_factor);
+    }
 
-    undo_redo_collection(std::function<void(TElement)> clean_up)
-        : undo_steps_index(0), current_undo_step_group(nullptr), clean_up(new clean_up_function(clean_up))
-    {}
+    // Nothing can be recorded while an undo or a redo is done in slices: the step being replayed may be discarded or shifted.
+    void throw_if_pending() const
+    {
+        if (pending != pending_type::none)
+            throw std::logic_error("an exception occurred");
+    }
 
-    virtual ~undo_redo_collection()
+    undo_step_group* pending_group(std::size_t index) const
     {
-        reset_undo_steps();
-        if (clean_up != nullptr) {
-            clean_up_elements();
-            delete clean_up;
-        }
+        auto step = history->at(index);
+        return step->get_operation_type() == undo_step::operation_type::group ? static_cast<undo_step_group*>(step) : nullptr;
     }
 
-    const TElement& operator[](size_t index) const
+    void push(undo_step* step)
     {
-        return data[index];
+        if (current_undo_step_group == nullptr)
+            push_to_steps(step);
+        else
+            push_to_group(step);
     }
 
-    size_t size() const
+    void push_to_steps(undo_step* step)
     {
-        return data.size();
+        discard_redo_steps();
+        detach_history();
+        step->set_version(++last_version);
+        history->steps.push_back(step);
+        undo_steps_index++;
+        record();
+        std::for_each(observers.begin(), observers.end(), [](observer* observer) { observer->on_commit(); });
     }
 
-    iterator begin()
+    void push_to_group(undo_step* step)
     {
-        return data.begin();
+        if (current_undo_step_group == nullptr)
+            throw std::logic_error("an exception occurred");
+
+        current_undo_step_group->push_back(step);
     }
 
-    iterator end()
+    position_type append_element(const TElement& element)
     {
-        return data.end();
+        detach_data();
+        auto position = adapter.append(*data, element);
+        std::for_each(observers.begin(), observers.end(), [&](observer* observer) { observer->on_insert(position, element); });
+        return position;
     }
 
-    const_iterator cbegin() const
+    position_type insert_element(iterator before, const TElement& element)
     {
-        return data.cbegin();
+        detach_data();
+        auto position = adapter.insert(*data, before, element);
+        std::for_each(observers.begin(), observers.end(), [&](observer* observer) { observer->on_insert(position, element); });
+        return position;
     }
 
-    const_iterator cend() const
+    void restore_element(position_type& position, const TElement& element)
     {
-        return data.cend();
+        detach_data();
+        adapter.restore(*data, position, element);
+        std::for_each(observers.begin(), observers.end(), [&](observer* observer) { observer->on_insert(position, element); });
     }
 
-    void clear()
+    TElement erase_element(position_type& position)
     {
-        transaction transaction(*this);
-        while (data.size() > 0)
-            erase(begin());
+        detach_data();
+        auto erased_position = position;
+        auto element         = adapter.erase(*data, position);
+        std::for_each(observers.begin(), observers.end(), [&](observer* observer) { observer->on_erase(erased_position, element); });
+        return element;
     }
 
-    void reset()
+    void exchange_element(position_type position, TElement& element)
     {
-        clean_up_elements();
-        reset_undo_steps();
+        detach_data();
+        auto& current = adapter.at(*data, position);
+        std::swap(current, element);
+        std::for_each(observers.begin(), observers.end(), [&](observer* observer) { observer->on_update(position, element, current); });
     }
 
-    void push_back(TElement element)
+    // Only ranges of at least the parallel threshold go to the parallel algorithms; below it they cost more than they save.
+    bool runs_in_parallel(std::size_t count) const
     {
-        auto step = undo_step::add(data, element, clean_up);
-        push(step);
+        return parallel::enabled && count >= parallel_threshold;
     }
 
-    void erase(iterator iterator)
+    // Exchanges elements[index] with the element at positions[index] for every index in [first, last). The positions are distinct.
+    void exchange_elements(const std::pmr::vector<position_type>& positions, std::pmr::vector<TElement>& elements, std::size_t first, std::size_t last)
     {
-        auto step = undo_step::remove(data, std::distance(data.begin(), iterator), clean_up);
-        push(step);
+        detach_data();
+        // Observers are not required to be thread safe.
+        if (!observers.empty()) {
+            for (auto index = first; index < last; index++)
+                exchange_element(positions[index], elements[index]);
+            return;
+        }
+
+        if constexpr (std::is_integral_v<position_type>) {
+            auto [lowest, highest] = std::minmax_element(positions.begin() + first, positions.begin() + last);
+            adapter.prepare_concurrent_access(*data, *lowest, *highest + 1);
+        }
+        parallel::for_each(positions.begin() + first, positions.begin() + last, [&](const position_type& position) {
+            std::swap(adapter.at(*data, position), elements[&position - positions.data()]);
+        });
     }
 
-    void update(iterator iterator, TElement element)
+    void exchange_elements(std::size_t first, std::pmr::vector<TElement>& elements)
     {
-        auto step = undo_step::update(data, std::distance(data.begin(), iterator), element, clean_up);
-        push(step);
+        detach_data();
+        auto begin = std::next(data->begin(), first);
+        if (!observers.empty()) {
+            std::swap_ranges(elements.begin(), elements.end(), begin);
+            for (std::size_t index = 0; index < elements.size(); index++) {
+                std::for_each(observers.begin(), observers.end(), [&](observer* observer) {
+                    observer->on_update(first + index, elements[index], (*data)[first + index]);
+                });
+            }
+        } else if (runs_in_parallel(elements.size())) {
+            adapter.prepare_concurrent_access(*data, first, first + elements.size());
+            parallel::swap_ranges(elements.begin(), elements.end(), begin);
+        } else {
+            std::swap_ranges(elements.begin(), elements.end(), begin);
+        }
     }
 
-    bool undo()
+    void truncate_elements(std::size_t first, std::pmr::vector<TElement>& elements)
     {
-        if (undo_steps_index == 0)
-            return false;
+        detach_data();
+        if (observers.empty()) {
+            elements.assign(std::make_move_iterator(std::next(data->begin(), first)), std::make_move_iterator(data->end()));
+            data->erase(std::next(data->begin(), first), data->end());
+            return;
+        }
 
-        undo_steps[undo_steps_index - 1]->undo();
-        undo_steps_index--;
-        return true;
+        elements.resize(data->size() - first);
+        for (auto position = data->size(); position-- > first; )
+            elements[position - first] = erase_element(position);
     }
 
-    bool redo()
+    // Moves the elements at indices into elements and closes the gaps in one pass.
+    void compact_elements(const std::pmr::vector<std::size_t>& indices, std::pmr::vector<TElement>& elements)
     {
-        if (undo_steps_index == undo_steps.size())
-            return false;
+        detach_data();
+        elements.resize(indices.size());
+        if (!observers.empty()) {
+            for (auto index = indices.size(); index-- > 0; ) {
+                position_type position = indices[index];
+                elements[index] = erase_element(position);
+            }
+            return;
+        }
 
-        undo_steps[undo_steps_index]->redo();
-        undo_steps_index++;
-        return true;
+        auto        target = indices.front();
+        std::size_t next   = 0;
+        for (auto position = indices.front(); position < data->size(); position++) {
+            if (next < indices.size() && indices[next] == position)
+                elements[next++] = std::move((*data)[position]);
+            else
+                (*data)[target++] = std::move((*data)[position]);
+        }
+        data->erase(std::next(data->begin(), target), data->end());
     }
 
-    bool can_undo() const
+    // Puts the elements back at indices, moving each of the others once, from the back.
+    void merge_elements(const std::pmr::vector<std::size_t>& indices, std::pmr::vector<TElement>& elements)
     {
-        return undo_steps_index != 0;
+        detach_data();
+        if (!observers.empty()) {
+            for (std::size_t index = 0; index < indices.size(); index++) {
+                position_type position = indices[index];
+                restore_element(position, elements[index]);
+            }
+        } else {
+            auto source = data->size();
+            auto next   = indices.size();
+            data->resize(data->size() + indices.size());
+            for (auto position = data->size(); next > 0; ) {
+                if (indices[next - 1] == --position)
+                    (*data)[position] = std::move(elements[--next]);
+                else
+                    (*data)[position] = std::move((*data)[--source]);
+            }
+        }
+        elements.clear();
+        elements.shrink_to_fit();
     }
 
-    bool can_redo() const
+    void append_elements(std::pmr::vector<TElement>& elements)
     {
-        return undo_steps_index != undo_steps.size();
+        std::for_each(elements.begin(), elements.end(), [&](const TElement& element) { append_element(element); });
+        elements.clear();
+        elements.shrink_to_fit();
     }
 
-    class transaction
+    void release_element(position_type position)
     {
-        undo_redo_collection<TElement, TCollection>& collection;
-        
-    public:
-        transaction(undo_redo_collection<TElement, TCollection>& collection) : collection(collection)
-        {
-            collection.begin_transaction();
+        adapter.release(*data, position);
+    }
+
+    template <typename TFunction>
+    void reorder_elements(std::size_t first, std::size_t last, TFunction reorder)
+    {
+        detach_data();
+        auto begin = std::next(data->begin(), first);
+        auto end   = std::next(data->begin(), last);
+        if (observers.empty()) {
+            reorder(begin, end);
+            return;
         }
 
-        virtual ~transaction()
-        {
-            collection.end_transaction();
+        std::pmr::vector<TElement> old_elements(begin, end, resource);
+        reorder(begin, end);
+        for (std::size_t index = 0; index < old_elements.size(); index++) {
+            std::for_each(observers.begin(), observers.end(), [&](observer* observer) {
+                observer->on_update(first + index, old_elements[index], (*data)[first + index]);
+            });
         }
-    };
-    
-private:
-    void begin_transaction()
+    }
+
+    // A step that owns its elements would clean up the one still in the collection.
+    TElement begin_modification(position_type position)
     {
-        if (current_undo_step_group != nullptr)
+        throw_if_pending();
+
+        if (clean_up != nullptr)
             throw std::logic_error("an exception occurred");
 
-        current_undo_step_group = new undo_step_group(data);
+        detach_data();
+        return adapter.at(*data, position);
     }
 
-    void end_transaction()
+    // The prior value is moved on into the step, so that it is copied only once, by begin_modification().
+    void end_modification(position_type position, TElement&& element)
     {
-        if (current_undo_step_group == nullptr)
-            throw std::logic_error("an exception occurred");
+        std::for_each(observers.begin(), observers.end(), [&](observer* observer) { observer->on_update(position, element, adapter.at(*data, position)); });
+        if (current_undo_step_group != nullptr) {
+            current_undo_step_group->record(undo_step::operation_type::update, position, std::move(element));
+            return;
+        }
 
-        if (current_undo_step_group->size() == 0)
-            delete current_undo_step_group;
-        else
-            push_to_steps(current_undo_step_group);
-        current_undo_step_group = nullptr;
+        auto step = undo_step::modify(*this, position, std::move(element), clean_up);
+        push(step);
     }
-    
-    void push(undo_step* step)
+
+    void push_range_update(iterator first, std::pmr::vector<TElement> elements)
     {
-        if (current_undo_step_group == nullptr)
-            push_to_steps(step);
-        else
-            push_to_group(step);
+        static_assert(std::is_integral_v<position_type>, "update_range needs a random access collection");
+
+        throw_if_pending();
+
+        if (elements.empty())
+            return;
+        if (elements.size() > static_cast<std::size_t>(std::distance(first, end())))
+            throw std::out_of_range("update_range");
+
+        auto step = undo_step::template create<range_update_step>(resource, *this, std::distance(data->begin(), first), std::move(elements), clean_up);
+        step->redo();
+        push(step);
     }
 
-    void push_to_steps(undo_step* step)
+    void push_compaction(std::pmr::vector<std::size_t> indices)
+    {
+        static_assert(std::is_integral_v<position_type>, "erase_if and erase_indices need a random access collection");
+
+        throw_if_pending();
+
+        if (indices.empty())
+            return;
+
+        auto step = undo_step::template create<compaction_step>(resource, *this, std::move(indices), clean_up);
+        step->redo();
+        push(step);
+    }
+
+    template <typename TCompare>
+    void sort_by_permutation(iterator first, iterator last, TCompare compare, bool stable)
     {
-        if (undo_steps_index != undo_steps.size()) {
-            std::for_each(undo_steps.begin() + undo_steps_index, undo_steps.end(), [](undo_step* step) { delete step; });
-            undo_steps.erase(undo_steps.begin() + undo_steps_index, undo_steps.end());
+        static_assert(std::is_integral_v<position_type>, "sort needs a random access collection");
+
+        auto count = static_cast<std::size_t>(std::distance(first, last));
+        if (count > std::numeric_limits<std::uint32_t>::max())
+            throw std::length_error("too many elements to sort");
+
+        std::pmr::vector<std::uint32_t> permutation(count, resource);
+        std::iota(permutation.begin(), permutation.end(), 0);
+        auto less = [&](std::uint32_t left, std::uint32_t right) { return compare(first[left], first[right]); };
+        if (!runs_in_parallel(count))
+            stable ? std::stable_sort(permutation.begin(), permutation.end(), less) : std::sort(permutation.begin(), permutation.end(), less);
+        else {
+            auto offset = static_cast<std::size_t>(std::distance(data->begin(), first));
+            adapter.prepare_concurrent_access(*data, offset, offset + count);
+            stable ? parallel::stable_sort(permutation.begin(), permutation.end(), less) : parallel::sort(permutation.begin(), permutation.end(), less);
         }
 
-        undo_steps.push_back(step);
-        undo_steps_index++;
+        if (std::is_sorted(permutation.begin(), permutation.end()))
+            return;
+        reorder(reorder_step::reorder_type::permute, first, first, last, std::move(permutation));
     }
 
-    void push_to_group(undo_step* step)
+    void reorder(typename reorder_step::reorder_type type, iterator first, iterator middle, iterator last)
     {
-        if (current_undo_step_group == nullptr)
-            throw std::logic_error("an exception occurred");
+        reorder(type, first, middle, last, std::pmr::vector<std::uint32_t>(resource));
+    }
 
-        current_undo_step_group->push_back(step);
+    void reorder(typename reorder_step::reorder_type type, iterator first, iterator middle, iterator last, std::pmr::vector<std::uint32_t> permutation)
+    {
+        static_assert(std::is_integral_v<position_type>, "reordering needs a random access collection");
+
+        throw_if_pending();
+
+        auto step = undo_step::template create<reorder_step>(resource, *this, type, std::distance(data->begin(), first), std::distance(data->begin(), middle), std::distance(data->begin(), last), std::move(permutation));
+        step->redo();
+        push(step);
     }
 
-    static void undo_data(const std::vector<undo_step*>& undo_steps, std::vector<TElement>& undoes)
+    static void undo_data(const std::pmr::vector<undo_step*>& undo_steps, std::vector<TElement>& undoes)
     {
         for (auto step : undo_steps) {
             switch (step->get_operation_type()) {
@@ -387,18 +2159,53 @@ private:
 
     void reset_undo_steps()
     {
-        std::for_each(undo_steps.begin(), undo_steps.end(), [](undo_step* step) { delete step; });
-        undo_steps.clear();
+        clean_up_batch batch(clean_up);
+        if (history.use_count() > 1)
+            history = make_history();
+        else
+            history->clear();
+        forget();
 
-        delete current_undo_step_group;
+        undo_step::destroy(current_undo_step_group);
         current_undo_step_group = nullptr;
+        transaction_depth       = 0;
+        pending                 = pending_type::none;
         undo_steps_index        = 0;
+        base_version            = ++last_version;
+    }
+
+    // Shrinks the elements, unless they are shared, if their capacity exceeds factor times their size and the reservation.
+    void shrink_elements(std::size_t factor)
+    {
+        if constexpr (requires(TCollection& collection) { collection.capacity(); collection.shrink_to_fit(); collection.reserve(0); }) {
+            if (data.use_count() == 1 && data->capacity() > std::max(factor * data->size(), reserved_element_count)) {
+                data->shrink_to_fit();
+                data->reserve(reserved_element_count);
+            }
+        }
+    }
+
+    void shrink_history(std::size_t factor)
+    {
+        auto& steps = history->steps;
+        if (history.use_count() == 1 && steps.capacity() > std::max(factor * steps.size(), reserved_step_count)) {
+            steps.shrink_to_fit();
+            steps.reserve(reserved_step_count);
+        }
     }
 
     void clean_up_elements()
     {
-        std::for_each(this->begin(), this->end(), [&](TElement element) { (*clean_up)(element); });
-        data.clear();
+        if (clean_up != nullptr) {
+            if constexpr (requires(TCollection& collection) { std::span<const TElement>(collection.data(), collection.size()); })
+                (*clean_up)(std::span<const TElement>(data->data(), data->size()));
+            else
+                (*clean_up)(std::span<const TElement>(std::pmr::vector<TElement>(data->begin(), data->end(), resource)));
+        }
+        if (data.use_count() > 1)
+            data = make_data();
+        else
+            adapter.clear(*data);
     }
 };
 
@@ -406,13 +2213,22 @@ template <typename TElement, typename TCollection = std::vector<TElement*>>
 class undo_redo_pointer_collection : public undo_redo_collection<TElement*, TCollection>
 {
 public:
-    undo_redo_pointer_collection() : undo_redo_collection<TElement*, TCollection>([](TElement* pointer) { delete pointer; })
+    undo_redo_pointer_collection()
+        : undo_redo_collection<TElement*, TCollection>([](std::span<TElement* const> pointers) { std::for_each(pointers.begin(), pointers.end(), [](TElement* pointer) { delete pointer; }); })
     {}
 };
 
 template <typename TElement>
 using undo_redo_vector = undo_redo_collection<TElement>;
 
+namespace pmr {
+
+// Keeps the elements in the memory resource of the collection as well.
+template <typename TElement>
+using undo_redo_vector = undo_redo_collection<TElement, std::pmr::vector<TElement>>;
+
+} // namespace pmr
+
 template <typename TElement>
 using undo_redo_pointer_vector = undo_redo_pointer_collection<TElement>;
 